@@ -0,0 +1,319 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <utility>
+#include <limits>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "sorting/Sorting.h"
+
+namespace sorting
+{
+
+// Default number of independently locked shards in a ComparisonStore.
+static constexpr size_t COMPARISON_STORE_SHARDS = 16;
+// Default capacity (in pairs) of the process-wide ComparisonStore.
+static constexpr size_t COMPARISON_STORE_CAPACITY = 1 << 20;
+
+// Concurrent, bounded store of answered pairwise comparisons keyed by global item id,
+// for sharing client answers between sessions that sort overlapping item sets. Lookups
+// take a shared lock on a single shard; each shard evicts with the CLOCK policy once
+// full, so memory stays bounded by the configured capacity.
+class ComparisonStore
+{
+public:
+    explicit ComparisonStore(const size_t& capacity = COMPARISON_STORE_CAPACITY,
+                             const size_t& numShards = COMPARISON_STORE_SHARDS)
+        : numShards_(std::max<size_t>(std::min(numShards, capacity), 1))
+    {
+        // Shard capacities sum to the configured capacity (at least one pair per shard)
+        const size_t total = std::max<size_t>(capacity, 1);
+        shards_.reserve(numShards_);
+        for (size_t k = 0; k < numShards_; k++)
+        {
+            shards_.emplace_back(new Shard(total / numShards_ + (k < total % numShards_ ? 1 : 0)));
+        }
+    }
+
+    // Recorded result of comparing a against b, or NOT_COMPARED if unknown.
+    uint32_t lookup(const uint32_t& a, const uint32_t& b) const
+    {
+        if (a == b)
+        {
+            return LEFT_EQUAL;
+        }
+        const uint64_t                      key   = comparisonPairKey(a, b);
+        const Shard&                        shard = shardFor(key);
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        auto                                it = shard.index.find(key);
+        if (it == shard.index.end())
+        {
+            return NOT_COMPARED;
+        }
+        const Slot& slot = shard.slots[it->second];
+        slot.referenced.store(true, std::memory_order_relaxed);
+        return a < b ? slot.c : flipComparison(slot.c);
+    }
+
+    // Record the result c of comparing a against b, replacing any earlier answer.
+    // Reports whether the result was well-formed and stored.
+    bool record(const uint32_t& a, const uint32_t& b, const uint32_t& c)
+    {
+        if (a == b || !(c == LEFT_LESS || c == LEFT_GREATER || c == LEFT_EQUAL))
+        {
+            return false;
+        }
+        const uint64_t                      key   = comparisonPairKey(a, b);
+        const uint32_t                      keyC  = a < b ? c : flipComparison(c);
+        Shard&                              shard = shardFor(key);
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        auto                                it = shard.index.find(key);
+        if (it != shard.index.end())
+        {
+            Slot& slot = shard.slots[it->second];
+            slot.c     = keyC;
+            slot.referenced.store(true, std::memory_order_relaxed);
+            return true;
+        }
+
+        size_t k;
+        if (shard.used < shard.capacity)
+        {
+            k = shard.used++;
+        }
+        else
+        {
+            // CLOCK eviction: skip (and clear) recently referenced slots
+            while (shard.slots[shard.hand].referenced.exchange(false, std::memory_order_relaxed))
+            {
+                shard.hand = (shard.hand + 1) % shard.capacity;
+            }
+            k          = shard.hand;
+            shard.hand = (shard.hand + 1) % shard.capacity;
+            shard.index.erase(shard.slots[k].key);
+        }
+        Slot& slot = shard.slots[k];
+        slot.key   = key;
+        slot.c     = keyC;
+        slot.referenced.store(false, std::memory_order_relaxed);
+        shard.index.emplace(key, k);
+        return true;
+    }
+
+    // Number of pairs currently stored.
+    size_t size() const
+    {
+        size_t total = 0;
+        for (const auto& shard : shards_)
+        {
+            std::shared_lock<std::shared_mutex> lock(shard->mutex);
+            total += shard->used;
+        }
+        return total;
+    }
+
+    // Persist all stored pairs to disk. Reports success status.
+    bool persistToDisk(const std::string& filename) const
+    {
+        std::vector<uint32_t> data = {0};
+        for (const auto& shard : shards_)
+        {
+            std::shared_lock<std::shared_mutex> lock(shard->mutex);
+            for (size_t k = 0; k < shard->used; k++)
+            {
+                const Slot& slot = shard->slots[k];
+                data.push_back(static_cast<uint32_t>(slot.key >> 32));
+                data.push_back(static_cast<uint32_t>(slot.key));
+                data.push_back(slot.c);
+                data[0]++;
+            }
+        }
+
+        // Write and fsync a uniquely named temporary file before renaming it over
+        // the store, so concurrent persists never share a file and neither a
+        // process nor an OS crash leaves a truncated store behind
+        std::string tmpFilename = filename + ".XXXXXX";
+        int         fd          = ::mkstemp(&tmpFilename[0]);
+        if (fd < 0)
+        {
+            return false;
+        }
+        const char* bytes   = reinterpret_cast<const char*>(data.data());
+        size_t      left    = data.size() * sizeof(uint32_t);
+        bool        success = true;
+        while (left > 0)
+        {
+            ssize_t written = ::write(fd, bytes, left);
+            if (written <= 0)
+            {
+                success = false;
+                break;
+            }
+            bytes += written;
+            left -= static_cast<size_t>(written);
+        }
+        success = ::fsync(fd) == 0 && success;
+        success = ::close(fd) == 0 && success;
+        if (!success || std::rename(tmpFilename.c_str(), filename.c_str()) != 0)
+        {
+            std::remove(tmpFilename.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    // Merge the pairs persisted in a file into the store. Reports success status.
+    bool loadFromDisk(const std::string& filename)
+    {
+        std::ifstream f(filename, std::ios::binary);
+        if (!f)
+        {
+            return false;
+        }
+
+        uint32_t count;
+        f.read((char*)&count, sizeof(uint32_t));
+        if (f.fail())
+        {
+            return false;
+        }
+        for (uint32_t k = 0; k < count; k++)
+        {
+            uint32_t a, b, c;
+            f.read((char*)&a, sizeof(uint32_t));
+            f.read((char*)&b, sizeof(uint32_t));
+            f.read((char*)&c, sizeof(uint32_t));
+            if (f.fail() || !record(a, b, c))
+            {
+                return false;
+            }
+        }
+
+        f.close();
+
+        return true;
+    }
+
+private:
+    struct Slot
+    {
+        uint64_t                  key = 0;
+        uint32_t                  c   = NOT_COMPARED;
+        mutable std::atomic<bool> referenced{false};
+    };
+
+    struct Shard
+    {
+        explicit Shard(const size_t& cap) : capacity(cap), slots(new Slot[cap])
+        {
+            index.reserve(cap);
+        }
+
+        mutable std::shared_mutex            mutex;
+        const size_t                         capacity;
+        size_t                               used = 0;
+        size_t                               hand = 0;
+        std::unique_ptr<Slot[]>              slots;
+        std::unordered_map<uint64_t, size_t> index;
+    };
+
+    const Shard& shardFor(const uint64_t& key) const
+    {
+        uint64_t h = key * 0x9e3779b97f4a7c15ull;
+        return *shards_[(h >> 32) % numShards_];
+    }
+
+    Shard& shardFor(const uint64_t& key)
+    {
+        return const_cast<Shard&>(static_cast<const ComparisonStore*>(this)->shardFor(key));
+    }
+
+    size_t                              numShards_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+};
+
+// Process-wide comparison store shared by all sessions.
+inline ComparisonStore& sharedComparisonStore()
+{
+    static ComparisonStore store;
+    return store;
+}
+
+// Advance a restfulQuickSort-family session, consulting a comparison store before
+// surfacing a comparison to the client. The client's answer in the input state is
+// recorded in the store, then the sort is stepped for as long as the store already
+// knows the requested comparison. Elements of arr are translated to global item ids
+// through globalIds (identity if empty). Reports success status.
+template<typename SortStep>
+inline std::pair<bool, QuickSortState> restfulSortWithStore(SortStep                     sortStep,
+                                                            const QuickSortState&        currentState,
+                                                            ComparisonStore&             store,
+                                                            const std::vector<uint32_t>& globalIds = {})
+{
+    auto globalId = [&globalIds](const uint32_t& k) { return globalIds.empty() ? k : globalIds[k]; };
+    auto pair     = [&globalId](const QuickSortState& s) {
+        uint32_t left = s.l == LEFT_I ? s.arr[s.i] : s.arr[s.j];
+        return std::make_pair(globalId(left), globalId(s.arr[s.p]));
+    };
+
+    if (!validateState(currentState))
+    {
+        return {false, currentState};
+    }
+    for (const auto& k : currentState.arr)
+    {
+        if (!globalIds.empty() && k >= globalIds.size())
+        {
+            return {false, currentState};
+        }
+    }
+    if (currentState.sorted == 0 && currentState.top < std::numeric_limits<uint32_t>::max() &&
+        currentState.c != NOT_COMPARED)
+    {
+        auto ab = pair(currentState);
+        store.record(ab.first, ab.second, currentState.c);
+    }
+
+    auto result = sortStep(currentState);
+    while (result.first && result.second.sorted == 0)
+    {
+        auto     ab = pair(result.second);
+        uint32_t c  = store.lookup(ab.first, ab.second);
+        if (c == NOT_COMPARED)
+        {
+            break;
+        }
+        result.second.c = c;
+        result          = sortStep(result.second);
+    }
+    return result;
+}
+
+// restfulQuickSort backed by a comparison store. Reports success status.
+inline std::pair<bool, QuickSortState> restfulQuickSortWithStore(const QuickSortState&        currentState,
+                                                                 ComparisonStore&             store,
+                                                                 const std::vector<uint32_t>& globalIds = {})
+{
+    return restfulSortWithStore(restfulQuickSort, currentState, store, globalIds);
+}
+
+// restfulRandomizedQuickSort backed by a comparison store. Reports success status.
+inline std::pair<bool, QuickSortState> restfulRandomizedQuickSortWithStore(const QuickSortState&        currentState,
+                                                                           ComparisonStore&             store,
+                                                                           const std::vector<uint32_t>& globalIds = {})
+{
+    return restfulSortWithStore(restfulRandomizedQuickSort, currentState, store, globalIds);
+}
+
+} // namespace sorting
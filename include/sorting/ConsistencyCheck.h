@@ -0,0 +1,517 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include <queue>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <limits>
+
+#include "sorting/Sorting.h"
+
+namespace sorting
+{
+
+// Log of answered client comparisons, used to detect contradictory answers.
+// Answers are kept oriented as they were asked. A re-ask that agrees with the
+// pair's latest answer only counts as a confirmation; one that disagrees is
+// kept alongside the earlier answer, so the conflict is reported by
+// findInconsistentComparisons until resolved.
+class ComparisonLog
+{
+public:
+    struct Answer
+    {
+        // Left input to the client comparator
+        uint32_t left;
+        // Right input to the client comparator
+        uint32_t right;
+        // Output of the client comparator given (left, right)
+        uint32_t c;
+    };
+
+    // Record the result c of comparing left against right. Reports whether the
+    // result was well-formed and stored.
+    bool record(const uint32_t& left, const uint32_t& right, const uint32_t& c)
+    {
+        if (left == right || !(c == LEFT_LESS || c == LEFT_GREATER || c == LEFT_EQUAL))
+        {
+            return false;
+        }
+        const uint64_t key = comparisonPairKey(left, right);
+        auto           it  = index_.find(key);
+        if (it == index_.end())
+        {
+            index_.emplace(key, Entry{answers_.size(), 1});
+            answers_.push_back({left, right, c});
+            return true;
+        }
+        it->second.asked++;
+        if (lookup(left, right) != c)
+        {
+            it->second.latest = answers_.size();
+            answers_.push_back({left, right, c});
+        }
+        return true;
+    }
+
+    // Settle the pair (left, right) on the result c, discarding every earlier
+    // answer for it. Reports whether the result was well-formed and stored.
+    bool resolve(const uint32_t& left, const uint32_t& right, const uint32_t& c)
+    {
+        if (left == right || !(c == LEFT_LESS || c == LEFT_GREATER || c == LEFT_EQUAL))
+        {
+            return false;
+        }
+        const uint64_t key   = comparisonPairKey(left, right);
+        const uint32_t asked = timesAsked(left, right);
+        answers_.erase(std::remove_if(answers_.begin(), answers_.end(),
+                                      [&key](const Answer& answer) {
+                                          return comparisonPairKey(answer.left, answer.right) == key;
+                                      }),
+                       answers_.end());
+        answers_.push_back({left, right, c});
+        index_[key].asked = asked + 1;
+        for (size_t k = 0; k < answers_.size(); k++)
+        {
+            index_[comparisonPairKey(answers_[k].left, answers_[k].right)].latest = k;
+        }
+        return true;
+    }
+
+    // Latest recorded result of comparing left against right, or NOT_COMPARED if unknown.
+    uint32_t lookup(const uint32_t& left, const uint32_t& right) const
+    {
+        auto it = index_.find(comparisonPairKey(left, right));
+        if (it == index_.end())
+        {
+            return NOT_COMPARED;
+        }
+        const Answer& answer = answers_[it->second.latest];
+        return answer.left == left ? answer.c : flipComparison(answer.c);
+    }
+
+    // Number of times the pair (left, right) was asked, in either orientation.
+    uint32_t timesAsked(const uint32_t& left, const uint32_t& right) const
+    {
+        auto it = index_.find(comparisonPairKey(left, right));
+        return it == index_.end() ? 0 : it->second.asked;
+    }
+
+    const std::vector<Answer>& answers() const
+    {
+        return answers_;
+    }
+
+    size_t size() const
+    {
+        return answers_.size();
+    }
+
+private:
+    struct Entry
+    {
+        // Position of the pair's latest answer in answers_
+        size_t latest;
+        // Number of times the pair was asked
+        uint32_t asked;
+    };
+
+    std::vector<Answer>                 answers_;
+    std::unordered_map<uint64_t, Entry> index_;
+};
+
+// Record the client's answer in a restfulQuickSort-family state, i.e. the
+// comparison of the current left input against the pivot. Reports success status.
+inline bool recordQuickSortComparison(ComparisonLog& log, const QuickSortState& state)
+{
+    if (!validateState(state) || state.c == NOT_COMPARED || state.sorted == 1 ||
+        state.top == std::numeric_limits<uint32_t>::max())
+    {
+        return false;
+    }
+    uint32_t left = state.l == LEFT_I ? state.arr[state.i] : state.arr[state.j];
+    return log.record(left, state.arr[state.p], state.c);
+}
+
+// Find comparisons whose recorded answers cannot all be true. Answers form a
+// graph of "left <= right" edges (strict for LEFT_LESS / LEFT_GREATER), and any
+// cycle through a strict edge is a contradiction. For every strongly connected
+// component containing one, the pairs of a shortest such cycle are reported as
+// the (left, right) pairs to re-ask; at least one of them was answered wrongly.
+// Each strict edge of an offending component costs one breadth-first search.
+// Only contradictions between recorded answers are found: a wrong answer that
+// no other answer contradicts shows up once it is re-asked (see
+// proposeSpotChecks).
+inline std::vector<std::pair<uint32_t, uint32_t>> findInconsistentComparisons(const ComparisonLog& log)
+{
+    struct Edge
+    {
+        uint32_t to;
+        uint32_t answer;
+        bool     strict;
+    };
+
+    // Graph construction over compact node indices
+    std::unordered_map<uint32_t, uint32_t> node;
+    std::vector<std::vector<Edge>>         adj;
+    auto nodeOf = [&node, &adj](const uint32_t& element) {
+        auto it = node.find(element);
+        if (it != node.end())
+        {
+            return it->second;
+        }
+        uint32_t k = static_cast<uint32_t>(adj.size());
+        node.emplace(element, k);
+        adj.emplace_back();
+        return k;
+    };
+    const auto& answers = log.answers();
+    for (uint32_t k = 0; k < answers.size(); k++)
+    {
+        uint32_t u = nodeOf(answers[k].left);
+        uint32_t v = nodeOf(answers[k].right);
+        if (answers[k].c == LEFT_LESS)
+        {
+            adj[u].push_back({v, k, true});
+        }
+        else if (answers[k].c == LEFT_GREATER)
+        {
+            adj[v].push_back({u, k, true});
+        }
+        else
+        {
+            adj[u].push_back({v, k, false});
+            adj[v].push_back({u, k, false});
+        }
+    }
+
+    // Iterative Tarjan strongly connected components
+    const uint32_t        unvisited = std::numeric_limits<uint32_t>::max();
+    const uint32_t        numNodes  = static_cast<uint32_t>(adj.size());
+    std::vector<uint32_t> order(numNodes, unvisited);
+    std::vector<uint32_t> low(numNodes, 0);
+    std::vector<uint32_t> comp(numNodes, unvisited);
+    std::vector<bool>     onStack(numNodes, false);
+    std::vector<uint32_t> stack;
+    std::vector<std::pair<uint32_t, uint32_t>> callStack; // (node, next edge)
+    uint32_t                                   counter  = 0;
+    uint32_t                                   numComps = 0;
+    for (uint32_t root = 0; root < numNodes; root++)
+    {
+        if (order[root] != unvisited)
+        {
+            continue;
+        }
+        callStack.push_back({root, 0});
+        while (!callStack.empty())
+        {
+            uint32_t u = callStack.back().first;
+            uint32_t e = callStack.back().second;
+            if (e == 0 && order[u] == unvisited)
+            {
+                order[u] = low[u] = counter++;
+                stack.push_back(u);
+                onStack[u] = true;
+            }
+            if (e < adj[u].size())
+            {
+                callStack.back().second++;
+                uint32_t v = adj[u][e].to;
+                if (order[v] == unvisited)
+                {
+                    callStack.push_back({v, 0});
+                }
+                else if (onStack[v])
+                {
+                    low[u] = std::min(low[u], order[v]);
+                }
+                continue;
+            }
+            if (low[u] == order[u])
+            {
+                uint32_t w;
+                do
+                {
+                    w = stack.back();
+                    stack.pop_back();
+                    onStack[w] = false;
+                    comp[w]    = numComps;
+                } while (w != u);
+                numComps++;
+            }
+            callStack.pop_back();
+            if (!callStack.empty())
+            {
+                uint32_t parent = callStack.back().first;
+                low[parent]     = std::min(low[parent], low[u]);
+            }
+        }
+    }
+
+    // Shortest contradicting cycle per offending component, measured in distinct
+    // pairs: every strict edge inside the component is tried, and a pair
+    // answered both ways (a single pair to re-ask) ends the search early
+    std::vector<std::vector<uint32_t>> best(numComps);
+    std::vector<uint32_t>              parentAnswer(numNodes, unvisited);
+    std::vector<uint32_t>              parentNode(numNodes, unvisited);
+    for (uint32_t u = 0; u < numNodes; u++)
+    {
+        for (const auto& edge : adj[u])
+        {
+            const uint32_t cu = comp[u];
+            if (!edge.strict || comp[edge.to] != cu || best[cu].size() == 1)
+            {
+                continue;
+            }
+
+            // Breadth-first search back from edge.to to u within the component
+            std::fill(parentAnswer.begin(), parentAnswer.end(), unvisited);
+            std::fill(parentNode.begin(), parentNode.end(), unvisited);
+            std::queue<uint32_t> frontier;
+            frontier.push(edge.to);
+            parentNode[edge.to] = edge.to;
+            while (!frontier.empty() && parentNode[u] == unvisited)
+            {
+                uint32_t x = frontier.front();
+                frontier.pop();
+                for (const auto& next : adj[x])
+                {
+                    if (comp[next.to] == cu && parentNode[next.to] == unvisited)
+                    {
+                        parentNode[next.to]   = x;
+                        parentAnswer[next.to] = next.answer;
+                        frontier.push(next.to);
+                    }
+                }
+            }
+
+            // Conflicting answers for one pair count once, as first asked
+            std::vector<uint32_t> cycle = {edge.answer};
+            for (uint32_t x = u; x != edge.to; x = parentNode[x])
+            {
+                cycle.push_back(parentAnswer[x]);
+            }
+            std::sort(cycle.begin(), cycle.end());
+            std::unordered_set<uint64_t> pairs;
+            std::vector<uint32_t>        distinct;
+            for (const auto& k : cycle)
+            {
+                if (pairs.insert(comparisonPairKey(answers[k].left, answers[k].right)).second)
+                {
+                    distinct.push_back(k);
+                }
+            }
+            if (best[cu].empty() || distinct.size() < best[cu].size())
+            {
+                best[cu] = distinct;
+            }
+        }
+    }
+
+    std::vector<std::pair<uint32_t, uint32_t>> reask;
+    for (const auto& cycle : best)
+    {
+        for (const auto& k : cycle)
+        {
+            reask.push_back({answers[k].left, answers[k].right});
+        }
+    }
+    return reask;
+}
+
+// Propose up to budget comparisons to re-ask so that a wrong answer shows up in
+// findInconsistentComparisons. In a sorted array the order of adjacent elements
+// typically rests on their one direct answer: for restfulQuickSort-family
+// sorts, a single flipped answer always leaves its two elements adjacent, and
+// no other answer contradicts it. Adjacent pairs asked exactly once are
+// proposed in array order; re-asking them marks them checked, so repeated
+// calls work through the whole array.
+inline std::vector<std::pair<uint32_t, uint32_t>> proposeSpotChecks(const std::vector<uint32_t>& arr,
+                                                                    const ComparisonLog&         log,
+                                                                    const size_t&                budget)
+{
+    std::vector<std::pair<uint32_t, uint32_t>> checks;
+    for (size_t k = 1; k < arr.size() && checks.size() < budget; k++)
+    {
+        if (log.timesAsked(arr[k - 1], arr[k]) == 1)
+        {
+            checks.push_back({arr[k - 1], arr[k]});
+        }
+    }
+    return checks;
+}
+
+// State required for sporadic, RESTful repair of a sorted array after one
+// comparison answer turned out to be wrong. The misplaced element is removed
+// and binary-inserted into the sub-range it can legally occupy, which costs
+// O(log n) client comparisons once the wrong answer is known. Finding it is
+// the expensive part: a single flipped restfulQuickSort-family answer creates
+// no contradiction, so detection takes O(n) spot-check re-asks unless
+// redundant answers already exist.
+struct RepairState
+{
+    // Whether the repair is complete (1) or not (0)
+    uint32_t repaired = 0;
+    // Number of elements in the array
+    uint32_t n = 0;
+    // Array under repair
+    std::vector<uint32_t> arr;
+    // Current position of the misplaced element
+    uint32_t k;
+    // Remaining insertion search range [lo, hi): the element belongs before arr[lo, hi]
+    uint32_t lo;
+    uint32_t hi;
+    // Current output of the client comparator given (arr[k], arr[(lo + hi) / 2])
+    // 0: NOT COMPARED; 1: l < r; 2: l > r; 3: l = r
+    uint32_t c = 0;
+};
+
+// Verify that the input state is formatted logically.
+inline bool validateRepairState(const RepairState& state)
+{
+    if (state.n == 0 || state.arr.size() != state.n)
+    {
+        return false;
+    }
+    if (state.repaired == 0 && (state.k >= state.n || state.lo > state.hi || state.hi > state.n ||
+                                (state.lo <= state.k && state.k < state.hi)))
+    {
+        return false;
+    }
+    if (!(state.c == NOT_COMPARED || state.c == LEFT_LESS || state.c == LEFT_GREATER || state.c == LEFT_EQUAL))
+    {
+        return false;
+    }
+    return true;
+}
+
+// Comparator inputs of a repair state, as (left, right) elements.
+inline std::pair<uint32_t, uint32_t> repairInputs(const RepairState& state)
+{
+    return {state.arr[state.k], state.arr[state.lo + (state.hi - state.lo) / 2]};
+}
+
+// Begin repairing a sorted array given the corrected answer c for comparing
+// element against other, as reported by findInconsistentComparisons. element is
+// treated as the misplaced one (for restfulQuickSort-family logs, the non-pivot
+// left input). The search is narrowed by answers already in the log, so the
+// repair is confined to the sub-range the element can legally occupy, which is
+// why the pair should be settled with ComparisonLog::resolve first. The repair
+// itself costs O(log n) comparisons; detecting the wrong answer is not included
+// (see RepairState). Reports success status.
+inline std::pair<bool, RepairState> startRepair(const std::vector<uint32_t>& arr,
+                                                const ComparisonLog&         log,
+                                                const uint32_t&              element,
+                                                const uint32_t&              other,
+                                                const uint32_t&              c)
+{
+    RepairState state;
+    state.n   = static_cast<uint32_t>(arr.size());
+    state.arr = arr;
+
+    auto x = std::find(arr.begin(), arr.end(), element);
+    auto p = std::find(arr.begin(), arr.end(), other);
+    if (x == arr.end() || p == arr.end() || x == p || !(c == LEFT_LESS || c == LEFT_GREATER || c == LEFT_EQUAL))
+    {
+        return {false, state};
+    }
+    uint32_t px = static_cast<uint32_t>(x - arr.begin());
+    uint32_t pp = static_cast<uint32_t>(p - arr.begin());
+
+    // Already consistent with the corrected answer: nothing to repair
+    if (c == LEFT_EQUAL || (c == LEFT_LESS && px < pp) || (c == LEFT_GREATER && px > pp))
+    {
+        state.repaired = 1;
+        return {true, state};
+    }
+
+    state.k = px;
+    if (c == LEFT_GREATER)
+    {
+        // Moving right: the element belongs after other but before anything logged above it
+        state.lo = pp + 1;
+        state.hi = state.n;
+        for (uint32_t q = state.lo; q < state.n; q++)
+        {
+            if (log.lookup(element, arr[q]) == LEFT_LESS)
+            {
+                state.hi = q;
+                break;
+            }
+        }
+    }
+    else
+    {
+        // Moving left: the element belongs before other but after anything logged below it
+        state.lo = 0;
+        state.hi = pp;
+        for (uint32_t q = pp; q > 0; q--)
+        {
+            if (log.lookup(element, arr[q - 1]) == LEFT_GREATER)
+            {
+                state.lo = q;
+                break;
+            }
+        }
+    }
+    return {true, state};
+}
+
+// RESTful binary-insertion repair with a client-side comparator. All
+// necessary state information is contained in the RepairState input, and
+// the updated state is reflected in the output. The input state should
+// contain a comparator output for repairInputs (unless the search range is
+// already empty) and the output state requests the next comparison (unless
+// repaired = 1). Reports success status.
+inline std::pair<bool, RepairState> restfulRepair(const RepairState& currentState)
+{
+    RepairState state = currentState;
+
+    // Reject invalid input states
+    if (!validateRepairState(state))
+    {
+        return {false, state};
+    }
+    if (state.repaired == 1)
+    {
+        return {true, state};
+    }
+    if (state.lo < state.hi)
+    {
+        if (state.c == NOT_COMPARED)
+        {
+            return {false, state};
+        }
+        uint32_t m = state.lo + (state.hi - state.lo) / 2;
+        if (state.c == LEFT_LESS)
+        {
+            state.hi = m;
+        }
+        else
+        {
+            state.lo = m + 1;
+        }
+        state.c = NOT_COMPARED;
+    }
+    if (state.lo < state.hi)
+    {
+        return {true, state};
+    }
+
+    // Search complete: move the element in front of arr[lo]
+    if (state.lo > state.k)
+    {
+        std::rotate(state.arr.begin() + state.k, state.arr.begin() + state.k + 1, state.arr.begin() + state.lo);
+    }
+    else
+    {
+        std::rotate(state.arr.begin() + state.lo, state.arr.begin() + state.k, state.arr.begin() + state.k + 1);
+    }
+    state.repaired = 1;
+    return {true, state};
+}
+
+} // namespace sorting
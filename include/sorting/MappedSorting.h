@@ -0,0 +1,790 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <queue>
+#include <utility>
+#include <limits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "sorting/Sorting.h"
+
+namespace sorting
+{
+
+// Identifies a disk-backed sort session file ("SORT").
+static constexpr uint32_t MAPPED_MAGIC = 0x534f5254;
+// Capacity of the bounded quick sort stack. Partitions are pushed larger-first, so the
+// stack holds at most one pending (low, high) pair per halving of n.
+static constexpr uint32_t MAPPED_STACK_SIZE = 128;
+// Maximum number of runs combined by a single pass of the external merge engine.
+static constexpr uint32_t MAPPED_MAX_FAN_IN = 64;
+// Byte offset of the sortable array within the backing file.
+static constexpr size_t MAPPED_ARR_OFFSET = 4096;
+// Partitions at most this large are prefetched in full when they are opened.
+static constexpr size_t MAPPED_PREFETCH_BYTES = 64 << 20;
+// Elements of read-ahead assumed per merge input run when choosing the fan-in.
+static constexpr size_t MAPPED_MERGE_BLOCK = 4096;
+
+// Enumerated phases of the external merge engine.
+enum class MergePhase
+{
+    NONE      = 0,
+    RUNS      = 1,
+    MERGE     = 2,
+    COPY_BACK = 3
+};
+static constexpr uint32_t MERGE_NONE      = static_cast<uint32_t>(MergePhase::NONE);
+static constexpr uint32_t MERGE_RUNS      = static_cast<uint32_t>(MergePhase::RUNS);
+static constexpr uint32_t MERGE_MERGE     = static_cast<uint32_t>(MergePhase::MERGE);
+static constexpr uint32_t MERGE_COPY_BACK = static_cast<uint32_t>(MergePhase::COPY_BACK);
+
+// Committed progress of the external merge engine. The session header holds two
+// copies; a step fills in the inactive one and then switches mergeSlot to it, so
+// an interrupted step never leaves a half-updated copy in use.
+struct MergeProgress
+{
+    // Current phase of the external merge engine
+    uint32_t phase;
+    // Width of the sorted runs in the current merge source
+    uint32_t width;
+    // Number of runs combined per group in the current merge pass
+    uint32_t fanIn;
+    // Next element to process in the current merge phase or pass
+    uint32_t cursor;
+    // Whether the current merge source is the scratch file (1) or the array (0)
+    uint32_t inScratch;
+    // Next unconsumed element of each run in the current merge group
+    uint32_t heads[MAPPED_MAX_FAN_IN];
+};
+
+// Fixed-size session header, mapped directly from the start of the backing file.
+// The quick sort fields mirror those of QuickSortState.
+struct MappedSortHeader
+{
+    // Session file identifier (MAPPED_MAGIC)
+    uint32_t magic;
+    // Whether the array is sorted (1) or not (0)
+    uint32_t sorted;
+    // Number of elements in the sortable array
+    uint32_t n;
+    // Index of the top of the stack
+    uint32_t top;
+    // Current parition pivot element
+    uint32_t p;
+    // Current partition leftmost element
+    uint32_t i;
+    // Current partition rightmost element
+    uint32_t j;
+    // Current left input to client comparator (right input is the pivot)
+    uint32_t l;
+    // Current output of the client comparator given (l, r)
+    uint32_t c;
+    // Which copy of the merge progress is committed (0 or 1)
+    uint32_t mergeSlot;
+    // Double-buffered merge progress
+    MergeProgress merge[2];
+    // Bounded auxiliary stack for iterative quick sort
+    uint32_t stack[MAPPED_STACK_SIZE];
+};
+static_assert(sizeof(MappedSortHeader) <= MAPPED_ARR_OFFSET, "MappedSortHeader must fit before the array");
+
+class MappedQuickSortState;
+inline bool validateMappedState(const MappedQuickSortState& state);
+
+// State for sporadic, RESTful sorting of arrays too large to hold in memory. The
+// header and array live in a memory-mapped backing file, which doubles as the
+// persisted session format: checkpointing only flushes dirty pages.
+class MappedQuickSortState
+{
+public:
+    // Mapped session header
+    MappedSortHeader* hdr = nullptr;
+    // Mapped sortable array
+    uint32_t* arr = nullptr;
+
+    MappedQuickSortState() = default;
+    MappedQuickSortState(const MappedQuickSortState&) = delete;
+    MappedQuickSortState& operator=(const MappedQuickSortState&) = delete;
+    ~MappedQuickSortState()
+    {
+        close();
+    }
+
+    // Create a new session file holding the array [0, 1, ..., n - 1]. Reports success status.
+    bool create(const std::string& filename, const uint32_t& n)
+    {
+        close();
+        if (n == 0)
+        {
+            return false;
+        }
+        int fd = ::open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0)
+        {
+            return false;
+        }
+        size_t bytes = MAPPED_ARR_OFFSET + static_cast<size_t>(n) * sizeof(uint32_t);
+        if (::ftruncate(fd, static_cast<off_t>(bytes)) != 0 || !map(fd, bytes))
+        {
+            ::close(fd);
+            return false;
+        }
+        ::close(fd);
+        filename_ = filename;
+
+        hdr->magic          = MAPPED_MAGIC;
+        hdr->sorted         = 0;
+        hdr->n              = n;
+        hdr->top            = std::numeric_limits<uint32_t>::max();
+        hdr->l              = LEFT_J;
+        hdr->c              = NOT_COMPARED;
+        hdr->mergeSlot      = 0;
+        hdr->merge[0]       = MergeProgress();
+        hdr->merge[1]       = MergeProgress();
+        for (uint32_t k = 0; k < n; k++)
+        {
+            arr[k] = k;
+        }
+        return true;
+    }
+
+    // Resume the session stored in an existing file. Reports success status.
+    bool open(const std::string& filename)
+    {
+        close();
+        int fd = ::open(filename.c_str(), O_RDWR);
+        if (fd < 0)
+        {
+            return false;
+        }
+        struct stat st;
+        if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < MAPPED_ARR_OFFSET ||
+            !map(fd, static_cast<size_t>(st.st_size)))
+        {
+            ::close(fd);
+            return false;
+        }
+        ::close(fd);
+        filename_ = filename;
+
+        if (!validateMappedState(*this))
+        {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    // Flush all dirty pages of the session to disk. Reports success status. The
+    // flushed image is consistent against process crashes; an OS crash between
+    // checkpoints may leave pages written back by the kernel in any order.
+    bool checkpoint()
+    {
+        if (base_ == nullptr)
+        {
+            return false;
+        }
+        if (scratchBase_ != nullptr && ::msync(scratchBase_, scratchBytes_, MS_SYNC) != 0)
+        {
+            return false;
+        }
+        return ::msync(base_, bytes_, MS_SYNC) == 0;
+    }
+
+    // Unmap the session (without an explicit flush).
+    void close()
+    {
+        unmapScratch();
+        if (base_ != nullptr)
+        {
+            ::munmap(base_, bytes_);
+        }
+        base_  = nullptr;
+        bytes_ = 0;
+        hdr    = nullptr;
+        arr    = nullptr;
+        filename_.clear();
+    }
+
+    // Committed progress of the external merge engine.
+    const MergeProgress& mergeProgress() const
+    {
+        return hdr->merge[hdr->mergeSlot];
+    }
+
+    // Whether a session file is currently mapped.
+    bool isOpen() const
+    {
+        return base_ != nullptr;
+    }
+
+    // Size of the mapped backing file in bytes.
+    size_t mappedBytes() const
+    {
+        return bytes_;
+    }
+
+    const std::string& filename() const
+    {
+        return filename_;
+    }
+
+    // Path of the scratch file used by the external merge engine.
+    std::string scratchFilename() const
+    {
+        return filename_ + ".merge";
+    }
+
+    // Mapped scratch array of n elements, created on demand. Returns nullptr on failure.
+    uint32_t* scratch()
+    {
+        if (scratchBase_ != nullptr)
+        {
+            return static_cast<uint32_t*>(scratchBase_);
+        }
+        if (hdr == nullptr)
+        {
+            return nullptr;
+        }
+        int fd = ::open(scratchFilename().c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd < 0)
+        {
+            return nullptr;
+        }
+        size_t bytes = static_cast<size_t>(hdr->n) * sizeof(uint32_t);
+        void*  base  = MAP_FAILED;
+        if (::ftruncate(fd, static_cast<off_t>(bytes)) == 0)
+        {
+            base = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        }
+        ::close(fd);
+        if (base == MAP_FAILED)
+        {
+            return nullptr;
+        }
+        scratchBase_  = base;
+        scratchBytes_ = bytes;
+        return static_cast<uint32_t*>(scratchBase_);
+    }
+
+    // Unmap and delete the scratch file.
+    void removeScratch()
+    {
+        unmapScratch();
+        if (!filename_.empty())
+        {
+            std::remove(scratchFilename().c_str());
+        }
+    }
+
+    // Apply a madvise access hint to elements [low, high) of an array mapped by this session.
+    void advise(const uint32_t* data, const size_t& low, const size_t& high, const int& advice) const
+    {
+        if (data == nullptr || high <= low)
+        {
+            return;
+        }
+        static const uintptr_t pageSize = static_cast<uintptr_t>(::sysconf(_SC_PAGESIZE));
+        uintptr_t              begin    = reinterpret_cast<uintptr_t>(data + low) & ~(pageSize - 1);
+        uintptr_t              end      = reinterpret_cast<uintptr_t>(data + high);
+        ::madvise(reinterpret_cast<void*>(begin), end - begin, advice);
+    }
+
+    // Synchronously flush elements [low, high) of an array mapped by this session. Reports success status.
+    bool sync(const uint32_t* data, const size_t& low, const size_t& high) const
+    {
+        if (data == nullptr || high <= low)
+        {
+            return true;
+        }
+        static const uintptr_t pageSize = static_cast<uintptr_t>(::sysconf(_SC_PAGESIZE));
+        uintptr_t              begin    = reinterpret_cast<uintptr_t>(data + low) & ~(pageSize - 1);
+        uintptr_t              end      = reinterpret_cast<uintptr_t>(data + high);
+        return ::msync(reinterpret_cast<void*>(begin), end - begin, MS_SYNC) == 0;
+    }
+
+    // Synchronously flush the session header. Reports success status.
+    bool syncHeader() const
+    {
+        return base_ != nullptr && ::msync(base_, MAPPED_ARR_OFFSET, MS_SYNC) == 0;
+    }
+
+private:
+    bool map(int fd, size_t bytes)
+    {
+        void* base = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (base == MAP_FAILED)
+        {
+            return false;
+        }
+        base_  = base;
+        bytes_ = bytes;
+        hdr    = static_cast<MappedSortHeader*>(base_);
+        arr    = reinterpret_cast<uint32_t*>(static_cast<char*>(base_) + MAPPED_ARR_OFFSET);
+        // Partition sweeps and merge passes both walk the array front to back
+        advise(arr, 0, (bytes - MAPPED_ARR_OFFSET) / sizeof(uint32_t), MADV_SEQUENTIAL);
+        return true;
+    }
+
+    void unmapScratch()
+    {
+        if (scratchBase_ != nullptr)
+        {
+            ::munmap(scratchBase_, scratchBytes_);
+        }
+        scratchBase_  = nullptr;
+        scratchBytes_ = 0;
+    }
+
+    std::string filename_;
+    void*       base_         = nullptr;
+    size_t      bytes_        = 0;
+    void*       scratchBase_  = nullptr;
+    size_t      scratchBytes_ = 0;
+};
+
+// Verify that a mapped session is formatted logically, so that a corrupt or
+// stale backing file is rejected before any of its indices are used.
+inline bool validateMappedState(const MappedQuickSortState& state)
+{
+    if (state.hdr == nullptr || state.hdr->magic != MAPPED_MAGIC || state.hdr->n == 0)
+    {
+        return false;
+    }
+    const MappedSortHeader& s = *state.hdr;
+    const uint32_t          n = s.n;
+    if (state.mappedBytes() != MAPPED_ARR_OFFSET + static_cast<size_t>(n) * sizeof(uint32_t))
+    {
+        return false;
+    }
+    if (!(s.sorted == 0 || s.sorted == 1) || !(s.l == LEFT_I || s.l == LEFT_J))
+    {
+        return false;
+    }
+    if (!(s.c == NOT_COMPARED || s.c == LEFT_LESS || s.c == LEFT_GREATER || s.c == LEFT_EQUAL))
+    {
+        return false;
+    }
+
+    // Quick sort: nothing to compare before the first step, (low, high) pairs on
+    // the stack after it, and the open partition on top
+    if (s.top == std::numeric_limits<uint32_t>::max() && s.sorted == 0 && s.c != NOT_COMPARED)
+    {
+        return false;
+    }
+    if (s.top != std::numeric_limits<uint32_t>::max())
+    {
+        if (s.top >= MAPPED_STACK_SIZE || s.top % 2 == 0)
+        {
+            return false;
+        }
+        for (uint32_t k = 0; k < s.top; k += 2)
+        {
+            if (s.stack[k] >= s.stack[k + 1] || s.stack[k + 1] >= n)
+            {
+                return false;
+            }
+        }
+        const uint32_t low = s.stack[s.top - 1];
+        // i starts one before low, wrapping when low = 0
+        if (s.p != s.stack[s.top] || s.j < low || s.j >= s.p || s.i + 1 < low || s.i + 1 > s.j)
+        {
+            return false;
+        }
+    }
+
+    // Merge engine: the committed progress must describe the current pass
+    if (s.mergeSlot > 1)
+    {
+        return false;
+    }
+    const MergeProgress& m = s.merge[s.mergeSlot];
+    if (m.phase > MERGE_COPY_BACK || m.inScratch > 1)
+    {
+        return false;
+    }
+    if (m.phase == MERGE_NONE)
+    {
+        return true;
+    }
+    if (s.top != std::numeric_limits<uint32_t>::max() || m.width == 0 || m.width > n || m.cursor >= n)
+    {
+        return false;
+    }
+    if (m.phase == MERGE_MERGE)
+    {
+        if (m.fanIn < 2 || m.fanIn > MAPPED_MAX_FAN_IN || m.width >= n)
+        {
+            return false;
+        }
+        const size_t span = static_cast<size_t>(m.width) * m.fanIn;
+        const size_t g    = (m.cursor / span) * span;
+        const size_t gEnd = std::min<size_t>(g + span, n);
+        if (m.cursor == g)
+        {
+            return true; // heads are reset at the start of each group
+        }
+        size_t consumed = 0;
+        for (size_t r = 0; g + r * m.width < gEnd; r++)
+        {
+            const size_t runStart = g + r * m.width;
+            const size_t runEnd   = std::min<size_t>(runStart + m.width, gEnd);
+            if (m.heads[r] < runStart || m.heads[r] > runEnd)
+            {
+                return false;
+            }
+            consumed += m.heads[r] - runStart;
+        }
+        if (consumed != m.cursor - g)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// RESTful Deterministic Quick Sort over a disk-backed session. Follows the same
+// protocol as restfulQuickSort, but updates the mapped state in place and keeps
+// the stack bounded by always processing the smaller partition first. Call
+// checkpoint() on the session to persist progress. Swaps and header updates are
+// written in place with no ordering between them, so a checkpoint is a
+// consistent image against process crashes only: if the OS crashes after the
+// kernel wrote back some dirty pages but not others, a swap may be half on disk.
+// Reports success status.
+inline bool restfulMappedQuickSort(MappedQuickSortState& state)
+{
+    // Reject invalid input states
+    if (!validateMappedState(state))
+    {
+        return false;
+    }
+    MappedSortHeader& s = *state.hdr;
+    if (s.top < std::numeric_limits<uint32_t>::max() && s.c == NOT_COMPARED)
+    {
+        return false;
+    }
+    if (s.sorted == 1)
+    {
+        return true;
+    }
+    if (state.mergeProgress().phase != MERGE_NONE)
+    {
+        return false;
+    }
+
+    // Element swapper
+    auto swap = [&state](const uint32_t& i, const uint32_t& j) {
+        uint32_t tmp = state.arr[i];
+        state.arr[i] = state.arr[j];
+        state.arr[j] = tmp;
+    };
+
+    // Partition reset from top of the stack
+    auto resetPartition = [&state, &s]() {
+        auto h = s.stack[s.top];
+        auto l = s.stack[s.top - 1];
+
+        s.p = h;
+        s.i = l - 1;
+        s.j = l;
+
+        s.l = LEFT_J;
+        s.c = NOT_COMPARED;
+
+        if ((static_cast<size_t>(h) - l + 1) * sizeof(uint32_t) <= MAPPED_PREFETCH_BYTES)
+        {
+            state.advise(state.arr, l, static_cast<size_t>(h) + 1, MADV_WILLNEED);
+        }
+    };
+
+    // Algorithm initialization
+    if (s.top == std::numeric_limits<uint32_t>::max() && s.c == NOT_COMPARED)
+    {
+        if (s.n == 1)
+        {
+            s.sorted = 1;
+            return true;
+        }
+        s.stack[++s.top] = 0;       // low
+        s.stack[++s.top] = s.n - 1; // high
+        resetPartition();
+        return true;
+    }
+
+    // Continue with partitioning
+    if (s.l != LEFT_J)
+    {
+        return false;
+    }
+    if (s.c == LEFT_LESS || s.c == LEFT_EQUAL)
+    {
+        s.i++;
+        swap(s.i, s.j);
+    }
+    if (s.j < s.p - 1)
+    {
+        s.j++;
+        s.c = NOT_COMPARED;
+        return true;
+    }
+
+    swap(s.i + 1, s.p);
+    auto p = s.i + 1;
+    auto h = s.stack[s.top--];
+    auto l = s.stack[s.top--];
+
+    // Push the larger side first so that the smaller side is processed next
+    bool     hasLeft   = p != 0 && p - 1 > l;
+    bool     hasRight  = p + 1 < h;
+    uint32_t leftSize  = hasLeft ? p - l : 0;
+    uint32_t rightSize = hasRight ? h - p : 0;
+    if (hasLeft && leftSize >= rightSize)
+    {
+        s.stack[++s.top] = l;
+        s.stack[++s.top] = p - 1;
+    }
+    if (hasRight)
+    {
+        s.stack[++s.top] = p + 1;
+        s.stack[++s.top] = h;
+    }
+    if (hasLeft && leftSize < rightSize)
+    {
+        s.stack[++s.top] = l;
+        s.stack[++s.top] = p - 1;
+    }
+
+    if (s.top == std::numeric_limits<uint32_t>::max())
+    {
+        s.sorted = 1; // sorting complete
+    }
+    else
+    {
+        resetPartition();
+    }
+    return true;
+}
+
+// Perform one bounded unit of work of a resumable external multiway merge sort
+// over a disk-backed session, for use when the comparator is available locally.
+// cmp(a, b) must report whether element a orders strictly before element b.
+// memoryBudget (bytes) bounds both the initial run length and the work done per
+// step. The sort is stable. Runs are formed out of place into the scratch file and passes ping-pong
+// between the two files, so a step never modifies its own input; its output is
+// flushed before the new progress is committed to the session header. An
+// interrupted sort therefore resumes from the last completed step after
+// reopening the session. Reports success status.
+template<typename Compare>
+inline bool mappedMergeSortStep(MappedQuickSortState& state, Compare cmp, const size_t& memoryBudget)
+{
+    if (!validateMappedState(state))
+    {
+        return false;
+    }
+    MappedSortHeader& s = *state.hdr;
+    if (s.sorted == 1)
+    {
+        return true;
+    }
+    if (state.mergeProgress().phase == MERGE_NONE && s.top != std::numeric_limits<uint32_t>::max())
+    {
+        return false; // a quick sort is already in progress
+    }
+
+    const size_t  n       = s.n;
+    const size_t  elems   = std::max<size_t>(memoryBudget / sizeof(uint32_t), 2);
+    MergeProgress m       = state.mergeProgress();
+    auto          fanInOf = [&elems]() {
+        size_t fanIn = std::max<size_t>(elems / MAPPED_MERGE_BLOCK, 2);
+        return static_cast<uint32_t>(std::min<size_t>(fanIn, MAPPED_MAX_FAN_IN));
+    };
+    auto commit = [&state, &s](const MergeProgress& next) {
+        s.merge[1 - s.mergeSlot] = next;
+        if (!state.syncHeader())
+        {
+            return false;
+        }
+        s.mergeSlot = 1 - s.mergeSlot;
+        return state.syncHeader();
+    };
+    auto finish = [&state, &s, &commit]() {
+        if (!commit(MergeProgress()))
+        {
+            return false;
+        }
+        s.sorted     = 1;
+        s.top        = std::numeric_limits<uint32_t>::max();
+        s.c          = NOT_COMPARED;
+        bool success = state.syncHeader();
+        state.removeScratch();
+        return success;
+    };
+
+    // Engine initialization
+    if (m.phase == MERGE_NONE)
+    {
+        m           = MergeProgress();
+        m.phase     = MERGE_RUNS;
+        m.width     = static_cast<uint32_t>(std::min(elems, n));
+        m.inScratch = 1;
+        return commit(m);
+    }
+
+    uint32_t* scratch = state.scratch();
+    if (scratch == nullptr)
+    {
+        return false;
+    }
+
+    // Run formation: sort one budget-sized chunk of the array into the scratch file
+    if (m.phase == MERGE_RUNS)
+    {
+        size_t low  = m.cursor;
+        size_t high = std::min<size_t>(low + m.width, n);
+        state.advise(state.arr, low, high, MADV_WILLNEED);
+        std::vector<uint32_t> run(state.arr + low, state.arr + high);
+        std::stable_sort(run.begin(), run.end(), cmp);
+        std::copy(run.begin(), run.end(), scratch + low);
+        if (!state.sync(scratch, low, high))
+        {
+            return false;
+        }
+        if (high < n)
+        {
+            m.cursor = static_cast<uint32_t>(high);
+            return commit(m);
+        }
+        m.cursor = 0;
+        if (m.width >= n)
+        {
+            m.phase = MERGE_COPY_BACK;
+            return commit(m);
+        }
+        m.phase = MERGE_MERGE;
+        m.fanIn = fanInOf();
+        return commit(m);
+    }
+
+    // Copy back: the final pass landed in the scratch file
+    if (m.phase == MERGE_COPY_BACK)
+    {
+        size_t low  = m.cursor;
+        size_t high = std::min(low + elems, n);
+        std::copy(scratch + low, scratch + high, state.arr + low);
+        if (!state.sync(state.arr, low, high))
+        {
+            return false;
+        }
+        if (high < n)
+        {
+            m.cursor = static_cast<uint32_t>(high);
+            return commit(m);
+        }
+        return finish();
+    }
+
+    // Multiway merge: emit up to one budget's worth of output from the current pass
+    const uint32_t* src  = m.inScratch ? scratch : state.arr;
+    uint32_t*       dst  = m.inScratch ? state.arr : scratch;
+    const size_t    w    = m.width;
+    const size_t    span = w * m.fanIn;
+    const size_t    out0 = m.cursor;
+    size_t          out  = out0;
+    size_t          left = elems;
+    state.advise(src, 0, n, MADV_SEQUENTIAL);
+    state.advise(dst, 0, n, MADV_SEQUENTIAL);
+
+    while (left > 0 && out < n)
+    {
+        const size_t   g    = (out / span) * span;
+        const size_t   gEnd = std::min(g + span, n);
+        const uint32_t runs = static_cast<uint32_t>((gEnd - g + w - 1) / w);
+        if (out == g)
+        {
+            for (uint32_t r = 0; r < runs; r++)
+            {
+                m.heads[r] = static_cast<uint32_t>(g + r * w);
+            }
+        }
+
+        // Min-heap of runs keyed on their head element, ties broken by run order for stability
+        auto later = [&](const uint32_t& a, const uint32_t& b) {
+            const uint32_t& va = src[m.heads[a]];
+            const uint32_t& vb = src[m.heads[b]];
+            if (cmp(vb, va))
+            {
+                return true;
+            }
+            return !cmp(va, vb) && a > b;
+        };
+        std::priority_queue<uint32_t, std::vector<uint32_t>, decltype(later)> heap(later);
+        for (uint32_t r = 0; r < runs; r++)
+        {
+            if (m.heads[r] < std::min(g + (r + 1) * w, gEnd))
+            {
+                heap.push(r);
+            }
+        }
+        while (left > 0 && out < gEnd)
+        {
+            uint32_t r = heap.top();
+            heap.pop();
+            dst[out++] = src[m.heads[r]++];
+            left--;
+            if (m.heads[r] < std::min(g + (r + 1) * w, gEnd))
+            {
+                heap.push(r);
+            }
+        }
+    }
+
+    if (!state.sync(dst, out0, out))
+    {
+        return false;
+    }
+    if (out < n)
+    {
+        m.cursor = static_cast<uint32_t>(out);
+        return commit(m);
+    }
+
+    // Pass complete: the destination becomes the next source
+    m.inScratch = m.inScratch ? 0 : 1;
+    m.width     = static_cast<uint32_t>(std::min(span, n));
+    m.cursor    = 0;
+    if (m.width < n)
+    {
+        m.fanIn = fanInOf();
+        return commit(m);
+    }
+    if (m.inScratch)
+    {
+        m.phase = MERGE_COPY_BACK;
+        return commit(m);
+    }
+    return finish();
+}
+
+// Run the external merge engine on a disk-backed session until the array is sorted,
+// resuming any merge already in progress. Reports success status.
+template<typename Compare>
+inline bool mappedMergeSort(MappedQuickSortState& state, Compare cmp, const size_t& memoryBudget)
+{
+    while (state.isOpen() && state.hdr->sorted == 0)
+    {
+        if (!mappedMergeSortStep(state, cmp, memoryBudget))
+        {
+            return false;
+        }
+    }
+    return state.isOpen();
+}
+
+} // namespace sorting
@@ -0,0 +1,561 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <utility>
+#include <limits>
+
+#include "sorting/Sorting.h"
+
+namespace sorting
+{
+
+// Enumerated kinds of merge sort frontiers.
+enum class FrontierKind
+{
+    SPLIT = 0,
+    MERGE = 1
+};
+static constexpr uint32_t FRONTIER_SPLIT = static_cast<uint32_t>(FrontierKind::SPLIT);
+static constexpr uint32_t FRONTIER_MERGE = static_cast<uint32_t>(FrontierKind::MERGE);
+
+// Minimum ratio of a merge-path segment's length to the comparisons spent
+// binary-searching for its split point.
+static constexpr uint64_t MERGE_SEGMENT_FACTOR = 4;
+
+// An independent unit of merge work awaiting exactly one client comparison.
+// SPLIT frontiers binary-search the merge path of runs A = arr[a, aEnd) and
+// B = arr[b, bEnd) for how many elements of A precede output diagonal out.
+// MERGE frontiers merge A and B into aux starting at out.
+struct MergeFrontier
+{
+    // 0: SPLIT; 1: MERGE
+    uint32_t kind = FRONTIER_MERGE;
+    // Current left run range [a, aEnd)
+    uint32_t a    = 0;
+    uint32_t aEnd = 0;
+    // Current right run range [b, bEnd)
+    uint32_t b    = 0;
+    uint32_t bEnd = 0;
+    // MERGE: next output position in aux; SPLIT: diagonal relative to the merge
+    uint32_t out = 0;
+    // SPLIT: remaining search range [lo, hi) within A
+    uint32_t lo = 0;
+    uint32_t hi = 0;
+    // SPLIT: index of the search result in MergeSortState::splits
+    uint32_t id = 0;
+    // Current output of the client comparator given (left, right)
+    // 0: NOT COMPARED; 1: left < right; 2: left > right; 3: left = right
+    uint32_t c = NOT_COMPARED;
+};
+
+// State required for sporadic, RESTful client-server-type bottom-up merge sorting.
+// Unlike QuickSortState, many comparisons may be outstanding at once: every entry
+// of frontiers is runnable, and clients may answer any subset of them per step.
+struct MergeSortState
+{
+    // Whether the array is sorted (1) or not (0)
+    uint32_t sorted = 0;
+    // Number of elements in the sortable array
+    uint32_t n = 0;
+    // Desired number of concurrently runnable frontiers
+    uint32_t concurrency = 1;
+    // Sortable array (input of the current level)
+    std::vector<uint32_t> arr;
+    // Auxiliary array (output of the current level)
+    std::vector<uint32_t> aux;
+    // Width of the sorted runs being merged (0: not started)
+    uint32_t width = 0;
+    // Current level phase: 0: SPLIT; 1: MERGE
+    uint32_t phase = FRONTIER_SPLIT;
+    // Requested number of merge-path segments per merge in the current level
+    // (each merge is capped by mergePathSegments)
+    uint32_t segments = 1;
+    // Resolved merge-path split points of the current level
+    std::vector<uint32_t> splits;
+    // Currently runnable frontiers
+    std::vector<MergeFrontier> frontiers;
+};
+
+// Number of merge-path segments actually used for a merge of total elements.
+// Every split point costs about log2(total) client comparisons to find, so
+// segments are kept at least MERGE_SEGMENT_FACTOR times longer than that; this
+// also keeps all split diagonals of a merge distinct.
+inline uint32_t mergePathSegments(const uint32_t& segments, const uint64_t& total)
+{
+    uint64_t log2Total = 1;
+    while ((uint64_t(1) << log2Total) < total)
+    {
+        log2Total++;
+    }
+    uint64_t cap = std::max<uint64_t>(total / (MERGE_SEGMENT_FACTOR * log2Total), 1);
+    return static_cast<uint32_t>(std::min<uint64_t>(segments, cap));
+}
+
+// Verify that the input state is formatted logically, and that every frontier and
+// split point describes a merge of the current level, so that no step can index
+// past arr, aux, or splits.
+inline bool validateMergeState(const MergeSortState& state)
+{
+    const uint32_t n = state.n;
+    if (n == 0 || state.arr.size() != n || state.aux.size() != n || state.concurrency == 0 || state.segments == 0)
+    {
+        return false;
+    }
+    if (!(state.sorted == 0 || state.sorted == 1) || !(state.phase == FRONTIER_SPLIT || state.phase == FRONTIER_MERGE))
+    {
+        return false;
+    }
+    if (state.sorted == 1 || state.width == 0)
+    {
+        // Nothing in flight before the first step or after the last
+        return state.frontiers.empty() && (state.sorted == 1 || state.splits.empty());
+    }
+    const uint64_t w = state.width;
+    if (w >= n || (w & (w - 1)) != 0)
+    {
+        return false;
+    }
+
+    // Split diagonals of the current level, in the order resetLevel creates them
+    struct Split
+    {
+        uint32_t aStart;
+        uint32_t bStart;
+        uint32_t bEnd;
+        uint32_t d;
+    };
+    std::vector<Split> level;
+    if (state.phase == FRONTIER_SPLIT)
+    {
+        for (uint64_t start = 0; start < n; start += 2 * w)
+        {
+            uint32_t aStart = static_cast<uint32_t>(start);
+            uint32_t bStart = static_cast<uint32_t>(std::min<uint64_t>(start + w, n));
+            uint32_t bEnd   = static_cast<uint32_t>(std::min<uint64_t>(start + 2 * w, n));
+            uint64_t total  = bEnd - aStart;
+            uint32_t segs   = bEnd > bStart ? mergePathSegments(state.segments, total) : 1;
+            for (uint32_t k = 1; k < segs; k++)
+            {
+                level.push_back({aStart, bStart, bEnd, static_cast<uint32_t>(k * total / segs)});
+            }
+        }
+        if (state.splits.size() != level.size())
+        {
+            return false;
+        }
+        for (size_t k = 0; k < level.size(); k++)
+        {
+            const Split& sp = level[k];
+            uint32_t     la = sp.bStart - sp.aStart;
+            uint32_t     lb = sp.bEnd - sp.bStart;
+            if (state.splits[k] + lb < sp.d || state.splits[k] > std::min(sp.d, la))
+            {
+                return false;
+            }
+        }
+    }
+
+    for (const auto& f : state.frontiers)
+    {
+        if (f.kind != state.phase)
+        {
+            return false;
+        }
+        if (!(f.c == NOT_COMPARED || f.c == LEFT_LESS || f.c == LEFT_GREATER || f.c == LEFT_EQUAL))
+        {
+            return false;
+        }
+        if (f.kind == FRONTIER_SPLIT)
+        {
+            // The search range must stay on the merge path of its diagonal
+            if (f.id >= level.size())
+            {
+                return false;
+            }
+            const Split& sp = level[f.id];
+            uint32_t     la = sp.bStart - sp.aStart;
+            uint32_t     lb = sp.bEnd - sp.bStart;
+            if (f.a != sp.aStart || f.aEnd != sp.bStart || f.b != sp.bStart || f.bEnd != sp.bEnd || f.out != sp.d ||
+                f.lo >= f.hi || f.lo + lb < f.out || f.hi > std::min(f.out, la))
+            {
+                return false;
+            }
+        }
+        else
+        {
+            // Both remaining ranges lie in the runs of one merge, and out is where they meet
+            const uint64_t aStart = (f.a / (2 * w)) * 2 * w;
+            const uint64_t bStart = std::min<uint64_t>(aStart + w, n);
+            const uint64_t bEnd   = std::min<uint64_t>(aStart + 2 * w, n);
+            if (!(f.a < f.aEnd && f.aEnd <= bStart && bStart <= f.b && f.b < f.bEnd && f.bEnd <= bEnd) ||
+                static_cast<uint64_t>(f.out) != aStart + (f.a - aStart) + (f.b - bStart))
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Elements of arr to compare for a frontier, as (left, right).
+inline std::pair<uint32_t, uint32_t> mergeFrontierInputs(const MergeSortState& state, const MergeFrontier& f)
+{
+    if (f.kind == FRONTIER_SPLIT)
+    {
+        uint32_t mid = f.lo + (f.hi - f.lo) / 2;
+        return {state.arr[f.a + mid], state.arr[f.b + f.out - mid - 1]};
+    }
+    return {state.arr[f.a], state.arr[f.b]};
+}
+
+// Persist the merge sorting state to disk. Reports success status.
+inline bool persistMergeStateToDisk(const std::string& filename, const MergeSortState& state)
+{
+    std::ofstream f(filename);
+    if (!f)
+    {
+        return false;
+    }
+    if (!validateMergeState(state))
+    {
+        return false;
+    }
+
+    auto write = [&f](const uint32_t& field) { f.write((char*)&field, sizeof(uint32_t)); };
+    write(state.sorted);
+    write(state.n);
+    write(state.concurrency);
+    for (size_t i = 0; i < state.arr.size(); i++)
+    {
+        write(state.arr[i]);
+    }
+    for (size_t i = 0; i < state.aux.size(); i++)
+    {
+        write(state.aux[i]);
+    }
+    write(state.width);
+    write(state.phase);
+    write(state.segments);
+    write(static_cast<uint32_t>(state.splits.size()));
+    for (size_t i = 0; i < state.splits.size(); i++)
+    {
+        write(state.splits[i]);
+    }
+    write(static_cast<uint32_t>(state.frontiers.size()));
+    for (const auto& fr : state.frontiers)
+    {
+        write(fr.kind);
+        write(fr.a);
+        write(fr.aEnd);
+        write(fr.b);
+        write(fr.bEnd);
+        write(fr.out);
+        write(fr.lo);
+        write(fr.hi);
+        write(fr.id);
+        write(fr.c);
+    }
+
+    f.close();
+
+    return true;
+}
+
+// Recover the merge sorting state from disk. Reports success status.
+inline std::pair<bool, MergeSortState> mergeSortStateFromDisk(const std::string& filename)
+{
+    MergeSortState state;
+    std::ifstream  f(filename);
+    if (!f)
+    {
+        return {false, state};
+    }
+
+    auto readVector = [&f](std::vector<uint32_t>& v, const size_t& size) {
+        uint32_t read;
+        for (size_t i = 0; i < size; i++)
+        {
+            f.read((char*)&read, sizeof(uint32_t));
+            if (f.fail())
+            {
+                return false;
+            }
+            v.push_back(read);
+        }
+        return true;
+    };
+
+    uint32_t read;
+    _READ_STATE_FIELD(sorted)
+    _READ_STATE_FIELD(n)
+    _READ_STATE_FIELD(concurrency)
+    if (state.n == 0 || !readVector(state.arr, state.n) || !readVector(state.aux, state.n))
+    {
+        return {false, state};
+    }
+    _READ_STATE_FIELD(width)
+    _READ_STATE_FIELD(phase)
+    _READ_STATE_FIELD(segments)
+    uint32_t numSplits;
+    f.read((char*)&numSplits, sizeof(uint32_t));
+    if (f.fail() || !readVector(state.splits, numSplits))
+    {
+        return {false, state};
+    }
+    uint32_t numFrontiers;
+    f.read((char*)&numFrontiers, sizeof(uint32_t));
+    if (f.fail())
+    {
+        return {false, state};
+    }
+    std::vector<uint32_t> fields;
+    if (!readVector(fields, static_cast<size_t>(numFrontiers) * 10))
+    {
+        return {false, state};
+    }
+    for (size_t k = 0; k < fields.size(); k += 10)
+    {
+        MergeFrontier fr;
+        fr.kind = fields[k];
+        fr.a    = fields[k + 1];
+        fr.aEnd = fields[k + 2];
+        fr.b    = fields[k + 3];
+        fr.bEnd = fields[k + 4];
+        fr.out  = fields[k + 5];
+        fr.lo   = fields[k + 6];
+        fr.hi   = fields[k + 7];
+        fr.id   = fields[k + 8];
+        fr.c    = fields[k + 9];
+        state.frontiers.push_back(fr);
+    }
+
+    f.close();
+
+    return {validateMergeState(state), state};
+}
+
+// RESTful Parallel Bottom-Up Merge Sort with a client-side comparator.
+// All necessary state information is contained in the MergeSortState
+// input, and the updated sort state is reflected in the output. Every
+// frontier of the output state awaits a comparison of the elements given
+// by mergeFrontierInputs; the input state should answer at least one of
+// them (unless it's the first iteration: width = 0), and unanswered
+// frontiers carry over. Each level first splits every merge into
+// equal-length segments along its merge path so that up to concurrency
+// frontiers stay runnable even when few, long merges remain, without
+// letting split searches dominate the comparison count. Reports success
+// status.
+inline std::pair<bool, MergeSortState> restfulMergeSort(const MergeSortState& currentState)
+{
+    MergeSortState state = currentState;
+
+    // Reject invalid input states
+    if (!validateMergeState(state))
+    {
+        return {false, state};
+    }
+    if (state.sorted == 1)
+    {
+        return {true, state};
+    }
+    if (state.width > 0)
+    {
+        bool answered = false;
+        for (const auto& f : state.frontiers)
+        {
+            answered |= f.c != NOT_COMPARED;
+        }
+        if (!answered)
+        {
+            return {false, state};
+        }
+    }
+
+    // Level reset: split each pair of runs into merge-path segments
+    static auto resetLevel = [](MergeSortState& s) {
+        const uint32_t n      = s.n;
+        const uint32_t w      = s.width;
+        const uint32_t merges = static_cast<uint32_t>((n - 1) / (2 * static_cast<uint64_t>(w)) + 1);
+        s.phase               = FRONTIER_SPLIT;
+        s.segments            = std::max<uint32_t>((s.concurrency + merges - 1) / merges, 1);
+        s.splits.clear();
+        s.frontiers.clear();
+        for (uint64_t start = 0; start < n; start += 2 * static_cast<uint64_t>(w))
+        {
+            uint32_t aStart = static_cast<uint32_t>(start);
+            uint32_t bStart = static_cast<uint32_t>(std::min<uint64_t>(start + w, n));
+            uint32_t bEnd   = static_cast<uint32_t>(std::min<uint64_t>(start + 2 * static_cast<uint64_t>(w), n));
+            uint32_t la     = bStart - aStart;
+            uint32_t lb     = bEnd - bStart;
+            if (lb == 0)
+            {
+                std::copy(s.arr.begin() + aStart, s.arr.begin() + bStart, s.aux.begin() + aStart);
+                continue;
+            }
+            uint64_t total    = la + lb;
+            uint32_t segments = mergePathSegments(s.segments, total);
+            for (uint32_t k = 1; k < segments; k++)
+            {
+                MergeFrontier f;
+                f.kind = FRONTIER_SPLIT;
+                f.a    = aStart;
+                f.aEnd = bStart;
+                f.b    = bStart;
+                f.bEnd = bEnd;
+                f.out  = static_cast<uint32_t>(k * total / segments);
+                f.lo   = f.out > lb ? f.out - lb : 0;
+                f.hi   = std::min(f.out, la);
+                f.id   = static_cast<uint32_t>(s.splits.size());
+                s.splits.push_back(f.lo);
+                s.frontiers.push_back(f);
+            }
+        }
+    };
+
+    // Phase change: turn resolved split points into independent merge segments
+    static auto startMerges = [](MergeSortState& s) {
+        const uint32_t n   = s.n;
+        const uint32_t w   = s.width;
+        uint32_t       idx = 0;
+        s.phase            = FRONTIER_MERGE;
+        for (uint64_t start = 0; start < n; start += 2 * static_cast<uint64_t>(w))
+        {
+            uint32_t aStart = static_cast<uint32_t>(start);
+            uint32_t bStart = static_cast<uint32_t>(std::min<uint64_t>(start + w, n));
+            uint32_t bEnd   = static_cast<uint32_t>(std::min<uint64_t>(start + 2 * static_cast<uint64_t>(w), n));
+            uint32_t la     = bStart - aStart;
+            uint32_t lb     = bEnd - bStart;
+            if (lb == 0)
+            {
+                continue;
+            }
+            uint64_t total    = la + lb;
+            uint32_t segments = mergePathSegments(s.segments, total);
+            uint32_t prevI    = 0;
+            uint32_t prevD    = 0;
+            for (uint32_t k = 1; k <= segments; k++)
+            {
+                uint32_t i = k < segments ? s.splits[idx++] : la;
+                uint32_t d = static_cast<uint32_t>(k * total / segments);
+                // Contradictory answers may leave split points out of order; keep segments non-negative
+                i = std::min(std::max(i, prevI), prevI + (d - prevD));
+                if (d > prevD)
+                {
+                    MergeFrontier f;
+                    f.kind = FRONTIER_MERGE;
+                    f.a    = aStart + prevI;
+                    f.aEnd = aStart + i;
+                    f.b    = bStart + (prevD - prevI);
+                    f.bEnd = bStart + (d - i);
+                    f.out  = aStart + prevD;
+                    s.frontiers.push_back(f);
+                }
+                prevI = i;
+                prevD = d;
+            }
+        }
+    };
+
+    // Retire frontiers that no longer need comparisons and advance levels
+    static auto settle = [](MergeSortState& s) {
+        while (true)
+        {
+            std::vector<MergeFrontier> runnable;
+            for (auto& f : s.frontiers)
+            {
+                if (f.kind == FRONTIER_SPLIT && f.lo >= f.hi)
+                {
+                    s.splits[f.id] = f.lo;
+                }
+                else if (f.kind == FRONTIER_MERGE && (f.a >= f.aEnd || f.b >= f.bEnd))
+                {
+                    // One side exhausted: the remainder of the other follows in order
+                    auto out = std::copy(s.arr.begin() + f.a, s.arr.begin() + f.aEnd, s.aux.begin() + f.out);
+                    std::copy(s.arr.begin() + f.b, s.arr.begin() + f.bEnd, out);
+                }
+                else
+                {
+                    runnable.push_back(f);
+                }
+            }
+            s.frontiers = runnable;
+            if (!s.frontiers.empty())
+            {
+                return;
+            }
+
+            if (s.phase == FRONTIER_SPLIT)
+            {
+                startMerges(s);
+            }
+            else
+            {
+                std::swap(s.arr, s.aux);
+                if (s.width >= s.n - s.width)
+                {
+                    s.sorted = 1; // sorting complete
+                    s.splits.clear();
+                    return;
+                }
+                s.width *= 2;
+                resetLevel(s);
+            }
+        }
+    };
+
+    // Algorithm initialization
+    if (state.width == 0)
+    {
+        if (state.n == 1)
+        {
+            state.sorted = 1;
+            return {true, state};
+        }
+        state.width = 1;
+        resetLevel(state);
+        settle(state);
+        return {true, state};
+    }
+
+    // Continue with all answered frontiers
+    for (auto& f : state.frontiers)
+    {
+        if (f.c == NOT_COMPARED)
+        {
+            continue;
+        }
+        if (f.kind == FRONTIER_SPLIT)
+        {
+            uint32_t mid = f.lo + (f.hi - f.lo) / 2;
+            if (f.c == LEFT_GREATER)
+            {
+                f.hi = mid;
+            }
+            else
+            {
+                f.lo = mid + 1;
+            }
+        }
+        else
+        {
+            // Ties take from the left run, keeping the sort stable
+            if (f.c == LEFT_GREATER)
+            {
+                state.aux[f.out++] = state.arr[f.b++];
+            }
+            else
+            {
+                state.aux[f.out++] = state.arr[f.a++];
+            }
+        }
+        f.c = NOT_COMPARED;
+    }
+    settle(state);
+    return {true, state};
+}
+
+} // namespace sorting
@@ -58,6 +58,18 @@ static constexpr uint32_t LEFT_LESS    = static_cast<uint32_t>(ComparatorResult:
 static constexpr uint32_t LEFT_GREATER = static_cast<uint32_t>(ComparatorResult::LEFT_GREATER);
 static constexpr uint32_t LEFT_EQUAL   = static_cast<uint32_t>(ComparatorResult::LEFT_EQUAL);
 
+// Order-independent key of the element pair (a, b), with the smaller element in the high word.
+inline uint64_t comparisonPairKey(const uint32_t& a, const uint32_t& b)
+{
+    return a < b ? (static_cast<uint64_t>(a) << 32) | b : (static_cast<uint64_t>(b) << 32) | a;
+}
+
+// Comparator output for the inputs (b, a), given the output c for (a, b).
+inline uint32_t flipComparison(const uint32_t& c)
+{
+    return c == LEFT_LESS ? LEFT_GREATER : (c == LEFT_GREATER ? LEFT_LESS : c);
+}
+
 // Verify that the input state is formatted logically.
 inline bool validateState(const QuickSortState& state)
 {
@@ -0,0 +1,175 @@
+#include <boost/test/unit_test.hpp>
+#include <boost/log/core.hpp>
+#include <boost/log/trivial.hpp>
+#include <boost/log/expressions.hpp>
+#include <atomic>
+#include <limits>
+#include <map>
+#include <thread>
+#include <vector>
+
+#include "sorting/ComparisonStore.h"
+
+BOOST_AUTO_TEST_SUITE(TestComparisonStore)
+
+BOOST_AUTO_TEST_CASE(TestStoreLookupAndPersistence)
+{
+    sorting::ComparisonStore store(64, 4);
+    BOOST_CHECK_EQUAL(store.lookup(3, 7), sorting::NOT_COMPARED);
+    BOOST_CHECK_EQUAL(store.lookup(3, 3), sorting::LEFT_EQUAL);
+    BOOST_CHECK(!store.record(3, 3, sorting::LEFT_LESS));
+    BOOST_CHECK(!store.record(3, 7, sorting::NOT_COMPARED));
+    BOOST_CHECK(store.record(3, 7, sorting::LEFT_LESS));
+    BOOST_CHECK(store.record(9, 2, sorting::LEFT_EQUAL));
+    BOOST_CHECK_EQUAL(store.lookup(3, 7), sorting::LEFT_LESS);
+    BOOST_CHECK_EQUAL(store.lookup(7, 3), sorting::LEFT_GREATER);
+    BOOST_CHECK_EQUAL(store.lookup(2, 9), sorting::LEFT_EQUAL);
+    BOOST_CHECK(store.record(7, 3, sorting::LEFT_LESS));
+    BOOST_CHECK_EQUAL(store.lookup(3, 7), sorting::LEFT_GREATER);
+    BOOST_CHECK_EQUAL(store.size(), 2);
+
+    BOOST_CHECK(store.persistToDisk("comparison_store.log"));
+    sorting::ComparisonStore store2(64, 2);
+    BOOST_CHECK(!store2.loadFromDisk("fake_store.log"));
+    BOOST_CHECK(store2.loadFromDisk("comparison_store.log"));
+    BOOST_CHECK_EQUAL(store2.size(), 2);
+    BOOST_CHECK_EQUAL(store2.lookup(7, 3), sorting::LEFT_LESS);
+    BOOST_CHECK_EQUAL(store2.lookup(9, 2), sorting::LEFT_EQUAL);
+}
+
+BOOST_AUTO_TEST_CASE(TestStoreEviction)
+{
+    sorting::ComparisonStore store(8, 1);
+    for (uint32_t k = 1; k <= 8; k++)
+    {
+        BOOST_CHECK(store.record(0, k, sorting::LEFT_LESS));
+    }
+    BOOST_CHECK_EQUAL(store.size(), 8);
+
+    // Recently consulted pairs survive eviction
+    BOOST_CHECK_EQUAL(store.lookup(0, 1), sorting::LEFT_LESS);
+    BOOST_CHECK(store.record(0, 100, sorting::LEFT_GREATER));
+    BOOST_CHECK_EQUAL(store.size(), 8);
+    BOOST_CHECK_EQUAL(store.lookup(0, 1), sorting::LEFT_LESS);
+    BOOST_CHECK_EQUAL(store.lookup(0, 2), sorting::NOT_COMPARED);
+    BOOST_CHECK_EQUAL(store.lookup(0, 100), sorting::LEFT_GREATER);
+
+    // More shards than pairs still holds at most the configured capacity
+    sorting::ComparisonStore small(8, 16);
+    for (uint32_t k = 1; k <= 100; k++)
+    {
+        BOOST_CHECK(small.record(0, k, sorting::LEFT_LESS));
+    }
+    BOOST_CHECK_EQUAL(small.size(), 8);
+}
+
+BOOST_AUTO_TEST_CASE(TestStoreConcurrentAccess)
+{
+    sorting::ComparisonStore store(1 << 12, 8);
+    std::vector<std::thread> threads;
+    for (uint32_t t = 0; t < 4; t++)
+    {
+        threads.emplace_back([&store, t]() {
+            for (uint32_t k = 0; k < 1000; k++)
+            {
+                store.record(t * 1000 + k, t * 1000 + k + 1, sorting::LEFT_LESS);
+                store.lookup(k, k + 1);
+            }
+        });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    BOOST_CHECK_EQUAL(store.size(), 4000);
+    for (uint32_t k = 0; k < 4000; k++)
+    {
+        BOOST_CHECK_EQUAL(store.lookup(k + 1, k), sorting::LEFT_GREATER);
+    }
+
+    // Concurrent persists to one path each leave a complete store behind
+    std::atomic<uint32_t> persisted{0};
+    threads.clear();
+    for (uint32_t t = 0; t < 4; t++)
+    {
+        threads.emplace_back([&store, &persisted]() {
+            for (uint32_t k = 0; k < 10; k++)
+            {
+                persisted += store.persistToDisk("comparison_store_shared.log") ? 1 : 0;
+            }
+        });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    BOOST_CHECK_EQUAL(persisted.load(), 40);
+    sorting::ComparisonStore loaded(1 << 12, 8);
+    BOOST_CHECK(loaded.loadFromDisk("comparison_store_shared.log"));
+    BOOST_CHECK_EQUAL(loaded.size(), 4000);
+}
+
+BOOST_AUTO_TEST_CASE(TestIncrementalSortingSharedStore)
+{
+    auto updateComparator = [](const double& a, const double& b) {
+        if (a < b)
+        {
+            return sorting::LEFT_LESS;
+        }
+        else if (a > b)
+        {
+            return sorting::LEFT_GREATER;
+        }
+        else
+        {
+            return sorting::LEFT_EQUAL;
+        }
+    };
+
+    // Global catalogue and two overlapping sessions over it
+    std::map<uint32_t, double>  values  = {{10, 4.8}, {11, 10.0}, {12, 1.0}, {13, 2.5}, {14, 5.0}, {15, 7.5}};
+    const std::vector<uint32_t> region1 = {10, 11, 12, 13, 14, 15};
+    const std::vector<uint32_t> region2 = {15, 14, 13, 12, 11, 10};
+
+    sorting::ComparisonStore store(256);
+
+    auto runSession = [&](const std::vector<uint32_t>& globalIds) {
+        sorting::QuickSortState state;
+        state.n     = 6;
+        state.arr   = {0, 1, 2, 3, 4, 5};
+        state.stack = std::vector<uint32_t>(6, 0);
+
+        uint64_t       asked    = 0;
+        uint64_t       iter     = 0;
+        const uint64_t maxIters = 50;
+        while (state.sorted == 0 && iter < maxIters)
+        {
+            auto [iter_success, state_out] = sorting::restfulQuickSortWithStore(state, store, globalIds);
+            BOOST_CHECK(iter_success);
+            state = state_out;
+            if (state.sorted == 1)
+            {
+                break;
+            }
+            uint32_t left = state.l == sorting::LEFT_I ? state.arr[state.i] : state.arr[state.j];
+            state.c       = updateComparator(values[globalIds[left]], values[globalIds[state.arr[state.p]]]);
+            asked++;
+            iter++;
+        }
+
+        for (uint32_t k = 1; k < state.n; k++)
+        {
+            BOOST_CHECK_LE(values[globalIds[state.arr[k - 1]]], values[globalIds[state.arr[k]]]);
+        }
+        return asked;
+    };
+
+    // Repeated and overlapping sessions reuse the answers already given
+    uint64_t asked1 = runSession(region1);
+    BOOST_CHECK_GT(asked1, 0);
+    BOOST_CHECK_EQUAL(runSession(region1), 0);
+    BOOST_CHECK_LT(runSession(region2), asked1);
+    BOOST_CHECK_EQUAL(runSession(region2), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,261 @@
+#include <boost/test/unit_test.hpp>
+#include <boost/log/core.hpp>
+#include <boost/log/trivial.hpp>
+#include <boost/log/expressions.hpp>
+#include <limits>
+#include <sstream>
+#include <vector>
+
+#include "sorting/ConsistencyCheck.h"
+
+BOOST_AUTO_TEST_SUITE(TestConsistencyCheck)
+
+BOOST_AUTO_TEST_CASE(TestCycleDetection)
+{
+    sorting::ComparisonLog log;
+    BOOST_CHECK(!log.record(1, 1, sorting::LEFT_LESS));
+    BOOST_CHECK(!log.record(1, 2, sorting::NOT_COMPARED));
+    BOOST_CHECK(log.record(1, 2, sorting::LEFT_LESS));
+    BOOST_CHECK(log.record(3, 2, sorting::LEFT_GREATER));
+    BOOST_CHECK(log.record(4, 5, sorting::LEFT_EQUAL));
+    BOOST_CHECK(log.record(5, 6, sorting::LEFT_EQUAL));
+    BOOST_CHECK_EQUAL(log.lookup(2, 1), sorting::LEFT_GREATER);
+    BOOST_CHECK_EQUAL(log.lookup(2, 3), sorting::LEFT_LESS);
+    BOOST_CHECK_EQUAL(log.lookup(1, 3), sorting::NOT_COMPARED);
+    BOOST_CHECK(sorting::findInconsistentComparisons(log).empty());
+
+    // Equalities alone never contradict
+    BOOST_CHECK(log.record(6, 4, sorting::LEFT_EQUAL));
+    BOOST_CHECK(sorting::findInconsistentComparisons(log).empty());
+
+    // a < b, b < c, c < a
+    BOOST_CHECK(log.record(3, 1, sorting::LEFT_LESS));
+    auto reask = sorting::findInconsistentComparisons(log);
+    BOOST_CHECK_EQUAL(reask.size(), 3);
+
+    // Settling the bad answer clears the contradiction
+    BOOST_CHECK(!log.resolve(1, 3, sorting::NOT_COMPARED));
+    BOOST_CHECK(log.resolve(1, 3, sorting::LEFT_LESS));
+    BOOST_CHECK_EQUAL(log.size(), 6);
+    BOOST_CHECK_EQUAL(log.timesAsked(3, 1), 2);
+    BOOST_CHECK(sorting::findInconsistentComparisons(log).empty());
+
+    // A re-ask that agrees is only a confirmation
+    BOOST_CHECK(log.record(2, 3, sorting::LEFT_LESS));
+    BOOST_CHECK_EQUAL(log.size(), 6);
+    BOOST_CHECK_EQUAL(log.timesAsked(3, 2), 2);
+    BOOST_CHECK(sorting::findInconsistentComparisons(log).empty());
+
+    // A re-ask that changes is kept and reported, once, as first asked
+    BOOST_CHECK(log.record(2, 1, sorting::LEFT_LESS));
+    BOOST_CHECK_EQUAL(log.size(), 7);
+    BOOST_CHECK_EQUAL(log.lookup(1, 2), sorting::LEFT_GREATER);
+    reask = sorting::findInconsistentComparisons(log);
+    BOOST_CHECK_EQUAL(reask.size(), 1);
+    BOOST_CHECK(reask[0] == std::make_pair(1u, 2u));
+    BOOST_CHECK(log.resolve(2, 1, sorting::LEFT_GREATER));
+    BOOST_CHECK_EQUAL(log.size(), 6);
+    BOOST_CHECK(sorting::findInconsistentComparisons(log).empty());
+
+    // A conflicting pair is preferred over a longer cycle through the same elements
+    sorting::ComparisonLog ring;
+    for (uint32_t k = 1; k <= 5; k++)
+    {
+        BOOST_CHECK(ring.record(k, k % 5 + 1, sorting::LEFT_LESS));
+    }
+    BOOST_CHECK_EQUAL(sorting::findInconsistentComparisons(ring).size(), 5);
+    BOOST_CHECK(ring.record(4, 3, sorting::LEFT_LESS));
+    auto ringReask = sorting::findInconsistentComparisons(ring);
+    BOOST_CHECK_EQUAL(ringReask.size(), 1);
+    BOOST_CHECK(ringReask[0] == std::make_pair(3u, 4u));
+
+    // A strict answer between equal elements contradicts
+    BOOST_CHECK(log.record(4, 6, sorting::LEFT_GREATER));
+    reask = sorting::findInconsistentComparisons(log);
+    BOOST_CHECK_EQUAL(reask.size(), 1);
+    BOOST_CHECK(reask[0] == std::make_pair(6u, 4u));
+}
+
+BOOST_AUTO_TEST_CASE(TestSpotChecks)
+{
+    sorting::ComparisonLog log;
+    std::vector<uint32_t>  arr = {0, 1, 2, 3};
+    BOOST_CHECK(log.record(0, 1, sorting::LEFT_LESS));
+    BOOST_CHECK(log.record(2, 1, sorting::LEFT_GREATER));
+    BOOST_CHECK(log.record(2, 3, sorting::LEFT_LESS));
+    BOOST_CHECK(log.record(0, 3, sorting::LEFT_LESS));
+    BOOST_CHECK(sorting::proposeSpotChecks(arr, log, 0).empty());
+
+    // Adjacent pairs asked once are proposed in array order, up to the budget
+    auto checks = sorting::proposeSpotChecks(arr, log, 2);
+    BOOST_CHECK_EQUAL(checks.size(), 2);
+    BOOST_CHECK(checks[0] == std::make_pair(0u, 1u));
+    BOOST_CHECK(checks[1] == std::make_pair(1u, 2u));
+
+    // Re-asked pairs are checked, and pairs never asked have nothing to check
+    BOOST_CHECK(log.record(0, 1, sorting::LEFT_LESS));
+    BOOST_CHECK(log.record(1, 2, sorting::LEFT_LESS));
+    checks = sorting::proposeSpotChecks(arr, log, 8);
+    BOOST_CHECK_EQUAL(checks.size(), 1);
+    BOOST_CHECK(checks[0] == std::make_pair(2u, 3u));
+    BOOST_CHECK(sorting::proposeSpotChecks({3, 1, 0, 2}, log, 8).empty());
+}
+
+BOOST_AUTO_TEST_CASE(TestIncrementalSortingRepair)
+{
+    auto updateComparator = [](const uint32_t& a, const uint32_t& b) {
+        if (a < b)
+        {
+            return sorting::LEFT_LESS;
+        }
+        else if (a > b)
+        {
+            return sorting::LEFT_GREATER;
+        }
+        else
+        {
+            return sorting::LEFT_EQUAL;
+        }
+    };
+
+    const uint32_t n    = 64;
+    const uint32_t liar = 41;
+
+    // The client answers wrongly the first time the liar is compared, either as
+    // the left input or as the pivot
+    for (const bool liarIsPivot : {false, true})
+    {
+        sorting::QuickSortState state;
+        state.n = n;
+        for (uint32_t i = 0; i < n; i++)
+        {
+            state.arr.push_back((i * 29) % n);
+        }
+        state.stack = std::vector<uint32_t>(n, 0);
+
+        sorting::ComparisonLog log;
+        bool                   lied     = false;
+        uint64_t               iter     = 0;
+        const uint64_t         maxIters = 5000;
+        while (!(state.top == std::numeric_limits<uint32_t>::max() && state.c != 0) && iter < maxIters)
+        {
+            auto [iter_success, state_out] = sorting::restfulQuickSort(state);
+            BOOST_CHECK(iter_success);
+            state = state_out;
+            if (state.sorted == 1)
+            {
+                break;
+            }
+            uint32_t left  = state.arr[state.j];
+            uint32_t pivot = state.arr[state.p];
+            state.c        = updateComparator(left, pivot);
+            if (!lied && (liarIsPivot ? pivot : left) == liar)
+            {
+                state.c = state.c == sorting::LEFT_LESS ? sorting::LEFT_GREATER : sorting::LEFT_LESS;
+                lied    = true;
+            }
+            BOOST_CHECK(sorting::recordQuickSortComparison(log, state));
+            iter++;
+        }
+        BOOST_CHECK(lied);
+        BOOST_CHECK(sorting::findInconsistentComparisons(log).empty());
+        bool wrong = false;
+        for (uint32_t i = 0; i < n; i++)
+        {
+            wrong |= state.arr[i] != i;
+        }
+        BOOST_CHECK(wrong);
+
+        // Spot checks proposed by the log expose the wrong answer as a changed re-ask
+        uint64_t                                   spotChecks = 0;
+        std::vector<std::pair<uint32_t, uint32_t>> reask;
+        while (reask.empty())
+        {
+            auto checks = sorting::proposeSpotChecks(state.arr, log, 8);
+            if (checks.empty())
+            {
+                break;
+            }
+            for (const auto& check : checks)
+            {
+                BOOST_CHECK(log.record(check.first, check.second, updateComparator(check.first, check.second)));
+                spotChecks++;
+            }
+            reask = sorting::findInconsistentComparisons(log);
+        }
+        BOOST_CHECK_EQUAL(reask.size(), 1);
+        BOOST_CHECK_LT(spotChecks, n);
+
+        // Settle the conflict with a final re-ask and repair the misplaced element
+        uint64_t repairComparisons = 0;
+        for (const auto& pair : reask)
+        {
+            BOOST_CHECK(liarIsPivot ? pair.second == liar : pair.first == liar);
+            uint32_t c = updateComparator(pair.first, pair.second);
+            BOOST_CHECK(log.resolve(pair.first, pair.second, c));
+            auto [start_success, repair] = sorting::startRepair(state.arr, log, pair.first, pair.second, c);
+            BOOST_CHECK(start_success);
+            while (repair.repaired == 0)
+            {
+                if (repair.lo < repair.hi)
+                {
+                    auto lr  = sorting::repairInputs(repair);
+                    repair.c = updateComparator(lr.first, lr.second);
+                    BOOST_CHECK(log.record(lr.first, lr.second, repair.c));
+                    repairComparisons++;
+                }
+                auto [repair_success, repair_out] = sorting::restfulRepair(repair);
+                BOOST_CHECK(repair_success);
+                repair = repair_out;
+            }
+            state.arr = repair.arr;
+        }
+
+        std::stringstream ss;
+        ss << "Repair: " << spotChecks << " spot checks, " << repairComparisons << " insertion comparisons";
+        BOOST_LOG_TRIVIAL(debug) << ss.str();
+
+        BOOST_CHECK_LE(repairComparisons, 7);
+        BOOST_CHECK(sorting::findInconsistentComparisons(log).empty());
+        for (uint32_t i = 0; i < n; i++)
+        {
+            BOOST_CHECK_EQUAL(state.arr[i], i);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(TestRepairValidation)
+{
+    // No comparison is pending before the first sorting step
+    sorting::QuickSortState fresh;
+    fresh.n     = 4;
+    fresh.arr   = {0, 1, 2, 3};
+    fresh.stack = std::vector<uint32_t>(4, 0);
+    fresh.c     = sorting::LEFT_LESS;
+    sorting::ComparisonLog quickLog;
+    BOOST_CHECK(!sorting::recordQuickSortComparison(quickLog, fresh));
+    BOOST_CHECK_EQUAL(quickLog.size(), 0);
+
+    sorting::ComparisonLog log;
+    std::vector<uint32_t>  arr = {0, 1, 2, 3};
+    BOOST_CHECK(!sorting::startRepair(arr, log, 1, 1, sorting::LEFT_LESS).first);
+    BOOST_CHECK(!sorting::startRepair(arr, log, 1, 9, sorting::LEFT_LESS).first);
+    auto [consistent_success, consistent] = sorting::startRepair(arr, log, 1, 3, sorting::LEFT_LESS);
+    BOOST_CHECK(consistent_success);
+    BOOST_CHECK_EQUAL(consistent.repaired, 1);
+
+    auto [start_success, repair] = sorting::startRepair(arr, log, 3, 1, sorting::LEFT_LESS);
+    BOOST_CHECK(start_success);
+    BOOST_CHECK_EQUAL(repair.repaired, 0);
+    BOOST_CHECK(!sorting::restfulRepair(repair).first);
+    auto lr  = sorting::repairInputs(repair);
+    repair.c = sorting::LEFT_GREATER;
+    BOOST_CHECK_EQUAL(lr.first, 3);
+    BOOST_CHECK_EQUAL(lr.second, 0);
+    auto [repair_success, repaired] = sorting::restfulRepair(repair);
+    BOOST_CHECK(repair_success);
+    BOOST_CHECK_EQUAL(repaired.repaired, 1);
+    BOOST_CHECK(repaired.arr == std::vector<uint32_t>({0, 3, 1, 2}));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,296 @@
+#include <boost/test/unit_test.hpp>
+#include <boost/log/core.hpp>
+#include <boost/log/trivial.hpp>
+#include <boost/log/expressions.hpp>
+#include <cstdio>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <limits>
+#include <vector>
+
+#include "sorting/MappedSorting.h"
+
+BOOST_AUTO_TEST_SUITE(TestMappedSorting)
+
+BOOST_AUTO_TEST_CASE(TestMappedPersistence)
+{
+    sorting::MappedQuickSortState state;
+    BOOST_CHECK(!state.open("fake_mapped.log"));
+    BOOST_CHECK(!state.create("mapped_state.log", 0));
+    BOOST_CHECK(state.create("mapped_state.log", 4));
+    BOOST_CHECK(sorting::validateMappedState(state));
+    BOOST_CHECK_EQUAL(state.mappedBytes(), sorting::MAPPED_ARR_OFFSET + 4 * sizeof(uint32_t));
+    state.arr[0]        = 3;
+    state.arr[3]        = 0;
+    state.hdr->top      = 1;
+    state.hdr->p        = 3;
+    state.hdr->i        = std::numeric_limits<uint32_t>::max();
+    state.hdr->j        = 0;
+    state.hdr->c        = sorting::LEFT_GREATER;
+    state.hdr->stack[0] = 0;
+    state.hdr->stack[1] = 3;
+    BOOST_CHECK(state.checkpoint());
+    state.close();
+
+    sorting::MappedQuickSortState state2;
+    BOOST_CHECK(state2.open("mapped_state.log"));
+    BOOST_CHECK_EQUAL(state2.hdr->n, 4);
+    BOOST_CHECK_EQUAL(state2.arr[0], 3);
+    BOOST_CHECK_EQUAL(state2.arr[1], 1);
+    BOOST_CHECK_EQUAL(state2.arr[3], 0);
+    BOOST_CHECK_EQUAL(state2.hdr->top, 1);
+    BOOST_CHECK_EQUAL(state2.hdr->p, 3);
+    BOOST_CHECK_EQUAL(state2.hdr->c, sorting::LEFT_GREATER);
+    BOOST_CHECK_EQUAL(state2.hdr->stack[1], 3);
+
+    state2.hdr->top = sorting::MAPPED_STACK_SIZE;
+    BOOST_CHECK(!sorting::validateMappedState(state2));
+    BOOST_CHECK(!sorting::restfulMappedQuickSort(state2));
+}
+
+BOOST_AUTO_TEST_CASE(TestMappedValidation)
+{
+    sorting::MappedQuickSortState state;
+    BOOST_CHECK(state.create("mapped_corrupt.log", 8));
+
+    // Corrupt quick sort fields
+    state.hdr->top      = 1;
+    state.hdr->stack[0] = 0;
+    state.hdr->stack[1] = 7;
+    state.hdr->p        = 7;
+    state.hdr->i        = std::numeric_limits<uint32_t>::max();
+    state.hdr->j        = 0;
+    BOOST_CHECK(sorting::validateMappedState(state));
+    state.hdr->top = 0;
+    BOOST_CHECK(!sorting::validateMappedState(state));
+    state.hdr->top      = 1;
+    state.hdr->stack[1] = 8;
+    BOOST_CHECK(!sorting::validateMappedState(state));
+    state.hdr->stack[1] = 7;
+    state.hdr->j        = 9;
+    BOOST_CHECK(!sorting::validateMappedState(state));
+    state.hdr->j = 0;
+    state.hdr->i = 3;
+    BOOST_CHECK(!sorting::validateMappedState(state));
+    state.hdr->i   = std::numeric_limits<uint32_t>::max();
+    state.hdr->top = std::numeric_limits<uint32_t>::max();
+
+    // An answer before the first step
+    state.hdr->c = sorting::LEFT_LESS;
+    BOOST_CHECK(!sorting::validateMappedState(state));
+    BOOST_CHECK(!sorting::restfulMappedQuickSort(state));
+    BOOST_CHECK(state.checkpoint());
+    state.close();
+    BOOST_CHECK(!state.open("mapped_corrupt.log"));
+    BOOST_CHECK(state.create("mapped_corrupt.log", 8));
+    BOOST_CHECK(state.checkpoint());
+
+    // Corrupt merge progress
+    sorting::MergeProgress& m = state.hdr->merge[state.hdr->mergeSlot];
+    m.phase                   = sorting::MERGE_MERGE;
+    m.width                   = 2;
+    m.fanIn                   = 2;
+    m.cursor                  = 1;
+    m.heads[0]                = 1;
+    m.heads[1]                = 2;
+    BOOST_CHECK(sorting::validateMappedState(state));
+    m.heads[1] = 3;
+    BOOST_CHECK(!sorting::validateMappedState(state));
+    m.heads[1] = 2;
+    m.width    = 0;
+    BOOST_CHECK(!sorting::validateMappedState(state));
+    m.width = 2;
+    m.fanIn = 0;
+    BOOST_CHECK(!sorting::validateMappedState(state));
+    state.hdr->mergeSlot = 2;
+    BOOST_CHECK(!sorting::validateMappedState(state));
+    state.hdr->mergeSlot = 0;
+    m.fanIn              = 2;
+    BOOST_CHECK(state.checkpoint());
+    state.close();
+    BOOST_CHECK(state.open("mapped_corrupt.log"));
+    state.hdr->merge[state.hdr->mergeSlot].width = 0;
+    BOOST_CHECK(state.checkpoint());
+    state.close();
+    BOOST_CHECK(!state.open("mapped_corrupt.log"));
+}
+
+BOOST_AUTO_TEST_CASE(TestMappedIncrementalSortingResumed)
+{
+    auto updateComparator = [](const uint32_t& a, const uint32_t& b) {
+        if (a < b)
+        {
+            return sorting::LEFT_GREATER;
+        }
+        else if (a > b)
+        {
+            return sorting::LEFT_LESS;
+        }
+        else
+        {
+            return sorting::LEFT_EQUAL;
+        }
+    };
+
+    const uint32_t n = 200;
+
+    sorting::MappedQuickSortState state;
+    BOOST_CHECK(state.create("mapped_sort.log", n));
+
+    uint32_t       maxTop   = 0;
+    uint64_t       iter     = 0;
+    const uint64_t maxIters = 50000;
+    while (state.hdr->sorted == 0 && iter < maxIters)
+    {
+        BOOST_CHECK(sorting::restfulMappedQuickSort(state));
+        if (state.hdr->sorted == 1)
+        {
+            break;
+        }
+        if (state.hdr->top != std::numeric_limits<uint32_t>::max())
+        {
+            maxTop = std::max(maxTop, state.hdr->top);
+        }
+        state.hdr->c = updateComparator(state.arr[state.hdr->j], state.arr[state.hdr->p]);
+
+        // Periodically drop the session and resume it from the backing file
+        if (iter % 97 == 0)
+        {
+            BOOST_CHECK(state.checkpoint());
+            state.close();
+            BOOST_CHECK(state.open("mapped_sort.log"));
+        }
+        iter++;
+    }
+
+    BOOST_CHECK_EQUAL(state.hdr->sorted, 1);
+    BOOST_CHECK_LT(maxTop, 2 * 9);
+    for (uint32_t i = 0; i < n; i++)
+    {
+        BOOST_CHECK_EQUAL(state.arr[i], n - 1 - i);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(TestMappedMergeSortResumed)
+{
+    const uint32_t n = 10007;
+
+    std::vector<uint32_t> values(n);
+    for (uint32_t i = 0; i < n; i++)
+    {
+        values[i] = (i * 7919u) % 1000;
+    }
+    auto cmp = [&values](const uint32_t& a, const uint32_t& b) { return values[a] < values[b]; };
+
+    sorting::MappedQuickSortState state;
+    BOOST_CHECK(state.create("mapped_merge.log", n));
+
+    // A small budget forces many runs and several merge passes
+    const size_t budget = 64 * sizeof(uint32_t);
+    uint64_t     steps  = 0;
+    while (state.hdr->sorted == 0 && steps < 100000)
+    {
+        BOOST_CHECK(sorting::mappedMergeSortStep(state, cmp, budget));
+        if (steps % 13 == 0)
+        {
+            state.close();
+            BOOST_CHECK(state.open("mapped_merge.log"));
+        }
+        steps++;
+    }
+
+    BOOST_CHECK_EQUAL(state.hdr->sorted, 1);
+    BOOST_CHECK_EQUAL(state.mergeProgress().phase, sorting::MERGE_NONE);
+    std::vector<bool> seen(n, false);
+    for (uint32_t i = 0; i < n; i++)
+    {
+        seen[state.arr[i]] = true;
+        if (i > 0)
+        {
+            BOOST_CHECK(!cmp(state.arr[i], state.arr[i - 1]));
+            // Stability
+            if (!cmp(state.arr[i - 1], state.arr[i]))
+            {
+                BOOST_CHECK_LT(state.arr[i - 1], state.arr[i]);
+            }
+        }
+    }
+    for (uint32_t i = 0; i < n; i++)
+    {
+        BOOST_CHECK(seen[i]);
+    }
+    BOOST_CHECK(std::fopen(state.scratchFilename().c_str(), "r") == nullptr);
+
+    // A quick sort session cannot be merge sorted midway, nor vice versa
+    sorting::MappedQuickSortState state2;
+    BOOST_CHECK(state2.create("mapped_merge2.log", 16));
+    BOOST_CHECK(sorting::restfulMappedQuickSort(state2));
+    BOOST_CHECK(!sorting::mappedMergeSortStep(state2, cmp, budget));
+    BOOST_CHECK(state2.create("mapped_merge2.log", 16));
+    BOOST_CHECK(sorting::mappedMergeSortStep(state2, cmp, budget));
+    BOOST_CHECK(!sorting::restfulMappedQuickSort(state2));
+    BOOST_CHECK(sorting::mappedMergeSort(state2, cmp, budget));
+    for (uint32_t i = 1; i < 16; i++)
+    {
+        BOOST_CHECK(!cmp(state2.arr[i], state2.arr[i - 1]));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(TestMappedMergeSortKilled)
+{
+    const uint32_t n      = 4096;
+    const size_t   budget = 256 * sizeof(uint32_t);
+
+    std::vector<uint32_t> values(n);
+    for (uint32_t i = 0; i < n; i++)
+    {
+        values[i] = (i * 7919u) % 1031;
+    }
+
+    // Kill the sorting process at points spread over run formation and every merge pass
+    for (uint64_t killAt = 100; killAt < 120000; killAt = killAt * 3 / 2 + 7)
+    {
+        sorting::MappedQuickSortState state;
+        BOOST_CHECK(state.create("mapped_killed.log", n));
+        BOOST_CHECK(state.checkpoint());
+        state.close();
+
+        pid_t pid = fork();
+        if (pid == 0)
+        {
+            sorting::MappedQuickSortState child;
+            uint64_t                      calls = 0;
+            auto cmp = [&values, &calls, &killAt](const uint32_t& a, const uint32_t& b) {
+                if (++calls == killAt)
+                {
+                    _exit(0);
+                }
+                return values[a] < values[b];
+            };
+            if (child.open("mapped_killed.log"))
+            {
+                sorting::mappedMergeSort(child, cmp, budget);
+            }
+            _exit(0);
+        }
+        int status;
+        BOOST_CHECK_EQUAL(waitpid(pid, &status, 0), pid);
+
+        auto cmp = [&values](const uint32_t& a, const uint32_t& b) { return values[a] < values[b]; };
+        BOOST_CHECK(state.open("mapped_killed.log"));
+        BOOST_CHECK(sorting::mappedMergeSort(state, cmp, budget));
+        std::vector<bool> seen(n, false);
+        uint32_t          distinct = 0;
+        bool              ordered  = true;
+        for (uint32_t i = 0; i < n; i++)
+        {
+            distinct += seen[state.arr[i]] ? 0 : 1;
+            seen[state.arr[i]] = true;
+            ordered &= i == 0 || !cmp(state.arr[i], state.arr[i - 1]);
+        }
+        BOOST_CHECK_EQUAL(distinct, n);
+        BOOST_CHECK(ordered);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
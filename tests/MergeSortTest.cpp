@@ -0,0 +1,358 @@
+#include <boost/test/unit_test.hpp>
+#include <boost/log/core.hpp>
+#include <boost/log/trivial.hpp>
+#include <boost/log/expressions.hpp>
+#include <algorithm>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <vector>
+
+#include "sorting/MergeSort.h"
+
+BOOST_AUTO_TEST_SUITE(TestMergeSort)
+
+BOOST_AUTO_TEST_CASE(TestMergePersistence)
+{
+    sorting::MergeSortState state;
+    BOOST_CHECK(!sorting::validateMergeState(state));
+    BOOST_CHECK(!sorting::persistMergeStateToDisk("merge_state.log", state));
+
+    state.n           = 9;
+    state.concurrency = 4;
+    state.arr         = {8, 7, 6, 5, 4, 3, 2, 1, 0};
+    state.aux         = std::vector<uint32_t>(9, 0);
+    auto [init_success, state1] = sorting::restfulMergeSort(state);
+    BOOST_CHECK(init_success);
+    BOOST_CHECK(!state1.frontiers.empty());
+    state1.frontiers[0].c = sorting::LEFT_GREATER;
+    BOOST_CHECK(sorting::persistMergeStateToDisk("merge_state.log", state1));
+    BOOST_CHECK(!sorting::mergeSortStateFromDisk("fake_log.log").first);
+    auto [read_success, state2] = sorting::mergeSortStateFromDisk("merge_state.log");
+    BOOST_CHECK(read_success);
+    BOOST_CHECK_EQUAL(state1.n, state2.n);
+    BOOST_CHECK_EQUAL(state1.concurrency, state2.concurrency);
+    BOOST_CHECK_EQUAL(state1.width, state2.width);
+    BOOST_CHECK_EQUAL(state1.phase, state2.phase);
+    BOOST_CHECK_EQUAL(state1.segments, state2.segments);
+    BOOST_CHECK(state1.arr == state2.arr);
+    BOOST_CHECK(state1.aux == state2.aux);
+    BOOST_CHECK(state1.splits == state2.splits);
+    BOOST_CHECK_EQUAL(state1.frontiers.size(), state2.frontiers.size());
+    for (size_t k = 0; k < state1.frontiers.size(); k++)
+    {
+        BOOST_CHECK_EQUAL(state1.frontiers[k].kind, state2.frontiers[k].kind);
+        BOOST_CHECK_EQUAL(state1.frontiers[k].a, state2.frontiers[k].a);
+        BOOST_CHECK_EQUAL(state1.frontiers[k].b, state2.frontiers[k].b);
+        BOOST_CHECK_EQUAL(state1.frontiers[k].out, state2.frontiers[k].out);
+        BOOST_CHECK_EQUAL(state1.frontiers[k].c, state2.frontiers[k].c);
+    }
+
+    // Stepping without any answered frontier is rejected
+    state2.frontiers[0].c = sorting::NOT_COMPARED;
+    BOOST_CHECK(!sorting::restfulMergeSort(state2).first);
+
+    // Frontiers and split points must describe the current level
+    sorting::MergeSortState corrupt = state1;
+    corrupt.width                   = 16;
+    BOOST_CHECK(!sorting::validateMergeState(corrupt));
+    corrupt       = state1;
+    corrupt.width = 3;
+    BOOST_CHECK(!sorting::validateMergeState(corrupt));
+    corrupt                   = state1;
+    corrupt.frontiers[0].aEnd = corrupt.frontiers[0].bEnd;
+    BOOST_CHECK(!sorting::validateMergeState(corrupt));
+    corrupt = state1;
+    corrupt.frontiers[0].out++;
+    BOOST_CHECK(!sorting::validateMergeState(corrupt));
+    corrupt = state1;
+    corrupt.frontiers[0].kind = 1 - corrupt.frontiers[0].kind;
+    BOOST_CHECK(!sorting::validateMergeState(corrupt));
+    corrupt       = state1;
+    corrupt.width = 0;
+    BOOST_CHECK(!sorting::validateMergeState(corrupt));
+
+    // Split points must match the level's merges and stay on their diagonals
+    sorting::MergeSortState split;
+    split.n           = 64;
+    split.concurrency = 4;
+    for (uint32_t i = 0; i < split.n; i++)
+    {
+        split.arr.push_back(split.n - 1 - i);
+    }
+    split.aux = std::vector<uint32_t>(split.n, 0);
+    split     = sorting::restfulMergeSort(split).second;
+    while (split.sorted == 0 && split.phase != sorting::FRONTIER_SPLIT)
+    {
+        for (auto& f : split.frontiers)
+        {
+            auto lr = sorting::mergeFrontierInputs(split, f);
+            f.c     = lr.first < lr.second ? sorting::LEFT_LESS : sorting::LEFT_GREATER;
+        }
+        split = sorting::restfulMergeSort(split).second;
+    }
+    BOOST_CHECK_EQUAL(split.phase, sorting::FRONTIER_SPLIT);
+    BOOST_CHECK(!split.splits.empty());
+    BOOST_CHECK(sorting::validateMergeState(split));
+    corrupt = split;
+    corrupt.splits.push_back(0);
+    BOOST_CHECK(!sorting::validateMergeState(corrupt));
+    corrupt           = split;
+    corrupt.splits[0] = split.n;
+    BOOST_CHECK(!sorting::validateMergeState(corrupt));
+    corrupt                 = split;
+    corrupt.frontiers[0].hi = split.n;
+    BOOST_CHECK(!sorting::validateMergeState(corrupt));
+    corrupt                 = split;
+    corrupt.frontiers[0].id = static_cast<uint32_t>(split.splits.size());
+    BOOST_CHECK(!sorting::validateMergeState(corrupt));
+
+    // A merge frontier writing past the end of its merge is rejected when read back
+    sorting::MergeSortState small;
+    small.n   = 4;
+    small.arr = {3, 2, 1, 0};
+    small.aux = std::vector<uint32_t>(4, 0);
+    auto [small_success, small1] = sorting::restfulMergeSort(small);
+    BOOST_CHECK(small_success);
+    BOOST_CHECK_EQUAL(small1.phase, sorting::FRONTIER_MERGE);
+    BOOST_CHECK(small1.splits.empty());
+    BOOST_CHECK_EQUAL(small1.frontiers[0].out, 0);
+    BOOST_CHECK(sorting::persistMergeStateToDisk("merge_state.log", small1));
+    {
+        // Header, arr, aux, level fields, and split and frontier counts precede frontiers[0].out
+        const uint32_t  out = 3;
+        std::fstream    f("merge_state.log", std::ios::in | std::ios::out | std::ios::binary);
+        f.seekp((3 + 2 * small1.n + 3 + 1 + 1 + 5) * sizeof(uint32_t));
+        f.write((char*)&out, sizeof(uint32_t));
+    }
+    BOOST_CHECK(!sorting::mergeSortStateFromDisk("merge_state.log").first);
+    small1.frontiers[0].out = 3;
+    small1.frontiers[0].c   = sorting::LEFT_LESS;
+    BOOST_CHECK(!sorting::restfulMergeSort(small1).first);
+}
+
+BOOST_AUTO_TEST_CASE(TestIncrementalMergeSortingParallel)
+{
+    auto updateComparator = [](const uint32_t& a, const uint32_t& b) {
+        if (a < b)
+        {
+            return sorting::LEFT_LESS;
+        }
+        else if (a > b)
+        {
+            return sorting::LEFT_GREATER;
+        }
+        else
+        {
+            return sorting::LEFT_EQUAL;
+        }
+    };
+
+    const uint32_t n           = 100;
+    const uint32_t concurrency = 8;
+
+    std::vector<uint32_t> values;
+    for (uint32_t i = 0; i < n; i++)
+    {
+        values.push_back((i * 37) % 23);
+    }
+
+    sorting::MergeSortState state;
+    state.n           = n;
+    state.concurrency = concurrency;
+    for (uint32_t i = 0; i < n; i++)
+    {
+        state.arr.push_back(i);
+    }
+    state.aux = std::vector<uint32_t>(n, 0);
+
+    uint64_t       rounds      = 0;
+    uint64_t       comparisons = 0;
+    uint64_t       lowRounds   = 0;
+    const uint64_t maxRounds   = 1000;
+    auto [init_success, init_state] = sorting::restfulMergeSort(state);
+    BOOST_CHECK(init_success);
+    state = init_state;
+    while (state.sorted == 0 && rounds < maxRounds)
+    {
+        // Every open frontier is answered concurrently, as if by separate clients
+        if (state.frontiers.size() < concurrency)
+        {
+            lowRounds++;
+        }
+        for (auto& f : state.frontiers)
+        {
+            auto lr = sorting::mergeFrontierInputs(state, f);
+            f.c     = updateComparator(values[lr.first], values[lr.second]);
+            comparisons++;
+        }
+
+        // Occasionally resume from disk
+        if (rounds % 5 == 0)
+        {
+            BOOST_CHECK(sorting::persistMergeStateToDisk("merge_sort.log", state));
+            auto [read_success, read_state] = sorting::mergeSortStateFromDisk("merge_sort.log");
+            BOOST_CHECK(read_success);
+            state = read_state;
+        }
+
+        auto [iter_success, state_out] = sorting::restfulMergeSort(state);
+        BOOST_CHECK(iter_success);
+        state = state_out;
+        rounds++;
+    }
+
+    std::stringstream ss;
+    ss << "Parallel merge sort: " << comparisons << " comparisons in " << rounds << " rounds, " << lowRounds
+       << " under-occupied";
+    BOOST_LOG_TRIVIAL(debug) << ss.str();
+
+    BOOST_CHECK_EQUAL(state.sorted, 1);
+    BOOST_CHECK(state.frontiers.empty());
+    BOOST_CHECK_LT(rounds, comparisons / 4);
+    for (uint32_t i = 1; i < n; i++)
+    {
+        BOOST_CHECK_LE(values[state.arr[i - 1]], values[state.arr[i]]);
+        // Stability
+        if (values[state.arr[i - 1]] == values[state.arr[i]])
+        {
+            BOOST_CHECK_LT(state.arr[i - 1], state.arr[i]);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(TestIncrementalMergeSortingPartialAnswers)
+{
+    auto updateComparator = [](const uint32_t& a, const uint32_t& b) {
+        if (a < b)
+        {
+            return sorting::LEFT_LESS;
+        }
+        else if (a > b)
+        {
+            return sorting::LEFT_GREATER;
+        }
+        else
+        {
+            return sorting::LEFT_EQUAL;
+        }
+    };
+
+    const uint32_t n = 37;
+
+    sorting::MergeSortState state;
+    state.n           = n;
+    state.concurrency = 3;
+    for (uint32_t i = 0; i < n; i++)
+    {
+        state.arr.push_back(n - 1 - i);
+    }
+    state.aux = std::vector<uint32_t>(n, 0);
+
+    uint64_t       iter     = 0;
+    const uint64_t maxIters = 5000;
+    auto [init_success, init_state] = sorting::restfulMergeSort(state);
+    BOOST_CHECK(init_success);
+    state = init_state;
+    while (state.sorted == 0 && iter < maxIters)
+    {
+        // Only the last open frontier is answered each step
+        auto& f  = state.frontiers.back();
+        auto  lr = sorting::mergeFrontierInputs(state, f);
+        f.c      = updateComparator(lr.first, lr.second);
+
+        auto [iter_success, state_out] = sorting::restfulMergeSort(state);
+        BOOST_CHECK(iter_success);
+        state = state_out;
+        iter++;
+    }
+
+    BOOST_CHECK_EQUAL(state.sorted, 1);
+    for (uint32_t i = 0; i < n; i++)
+    {
+        BOOST_CHECK_EQUAL(state.arr[i], i);
+    }
+
+    sorting::MergeSortState single;
+    single.n   = 1;
+    single.arr = {0};
+    single.aux = {0};
+    auto [single_success, single_out] = sorting::restfulMergeSort(single);
+    BOOST_CHECK(single_success);
+    BOOST_CHECK_EQUAL(single_out.sorted, 1);
+}
+
+BOOST_AUTO_TEST_CASE(TestMergeSortComparisonBudget)
+{
+    auto updateComparator = [](const uint32_t& a, const uint32_t& b) {
+        if (a < b)
+        {
+            return sorting::LEFT_LESS;
+        }
+        else if (a > b)
+        {
+            return sorting::LEFT_GREATER;
+        }
+        else
+        {
+            return sorting::LEFT_EQUAL;
+        }
+    };
+
+    const uint32_t n        = 1000;
+    const uint64_t nLog2n   = static_cast<uint64_t>(n) * 10;
+    uint64_t       baseline = 0;
+
+    // Asking for more concurrency than the merges can use must not inflate the comparison count
+    for (const uint32_t& concurrency : {1u, 16u, 1024u, 100000u})
+    {
+        std::vector<uint32_t> values;
+        for (uint32_t i = 0; i < n; i++)
+        {
+            values.push_back((i * 7919u) % 997);
+        }
+
+        sorting::MergeSortState state;
+        state.n           = n;
+        state.concurrency = concurrency;
+        for (uint32_t i = 0; i < n; i++)
+        {
+            state.arr.push_back(i);
+        }
+        state.aux = std::vector<uint32_t>(n, 0);
+
+        uint64_t comparisons  = 0;
+        size_t   maxFrontiers = 0;
+        auto [init_success, init_state] = sorting::restfulMergeSort(state);
+        BOOST_CHECK(init_success);
+        state = init_state;
+        while (state.sorted == 0 && comparisons < 100 * nLog2n)
+        {
+            maxFrontiers = std::max(maxFrontiers, state.frontiers.size());
+            for (auto& f : state.frontiers)
+            {
+                auto lr = sorting::mergeFrontierInputs(state, f);
+                f.c     = updateComparator(values[lr.first], values[lr.second]);
+                comparisons++;
+            }
+            auto [iter_success, state_out] = sorting::restfulMergeSort(state);
+            BOOST_CHECK(iter_success);
+            state = state_out;
+        }
+
+        BOOST_CHECK_EQUAL(state.sorted, 1);
+        for (uint32_t i = 1; i < n; i++)
+        {
+            BOOST_CHECK_LE(values[state.arr[i - 1]], values[state.arr[i]]);
+        }
+        if (concurrency == 1)
+        {
+            baseline = comparisons;
+        }
+        BOOST_CHECK_LE(comparisons, 2 * baseline);
+        BOOST_CHECK_LE(comparisons, 2 * nLog2n);
+        BOOST_CHECK_LE(maxFrontiers, n);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()